@@ -0,0 +1,154 @@
+/******************************************************************
+ * DETI/UA/IT - Real-Time Operating Systems course
+ *
+ * Fixed-size log-linear histograms. See histogram.h
+ *
+ *****************************************************************/
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <inttypes.h>
+
+#include "histogram.h"
+
+#define SUB_COUNT (1 << HIST_SUB_BITS)
+
+// Bucket of a value
+static int Hist_Index(int64_t value)
+{
+	int exp;
+
+	if (value < SUB_COUNT)
+		return value < 0 ? 0 : (int)value;
+
+	exp = 63 - __builtin_clzll((uint64_t)value); // floor(log2(value)) >= HIST_SUB_BITS
+	if (exp >= HIST_MAX_EXP)
+		return HIST_BUCKETS - 1;
+
+	return ((exp - HIST_SUB_BITS + 1) << HIST_SUB_BITS) + (int)((value >> (exp - HIST_SUB_BITS)) & (SUB_COUNT - 1));
+}
+
+int64_t Hist_BucketMax(int i)
+{
+	int exp;
+
+	if (i < SUB_COUNT)
+		return i;
+
+	exp = (i >> HIST_SUB_BITS) + HIST_SUB_BITS - 1;
+	return ((int64_t)(SUB_COUNT + (i & (SUB_COUNT - 1)) + 1) << (exp - HIST_SUB_BITS)) - 1;
+}
+
+void Hist_Init(struct histogram *h)
+{
+	memset(h, 0, sizeof(*h));
+}
+
+void Hist_Add(struct histogram *h, int64_t value)
+{
+	if (h->count == 0 || value < h->min)
+		h->min = value;
+	if (h->count == 0 || value > h->max)
+		h->max = value;
+
+	h->count++;
+	h->sum += value;
+	h->bucket[Hist_Index(value)]++;
+}
+
+void Hist_Merge(struct histogram *dst, const struct histogram *src)
+{
+	int i;
+
+	if (src->count == 0)
+		return;
+
+	if (dst->count == 0 || src->min < dst->min)
+		dst->min = src->min;
+	if (dst->count == 0 || src->max > dst->max)
+		dst->max = src->max;
+
+	dst->count += src->count;
+	dst->sum += src->sum;
+	for (i = 0; i < HIST_BUCKETS; i++)
+		dst->bucket[i] += src->bucket[i];
+}
+
+int64_t Hist_Percentile(const struct histogram *h, double percent)
+{
+	uint64_t rank, seen = 0;
+	int64_t value;
+	int i;
+
+	if (h->count == 0)
+		return 0;
+
+	/* Rank of the sample, 1..count */
+	rank = (uint64_t)(percent / 100.0 * h->count + 0.5);
+	if (rank < 1)
+		rank = 1;
+	if (rank > h->count)
+		rank = h->count;
+
+	for (i = 0; i < HIST_BUCKETS; i++)
+	{
+		seen += h->bucket[i];
+		if (seen >= rank)
+			break;
+	}
+
+	value = Hist_BucketMax(i);
+	if (value > h->max)
+		value = h->max;
+	if (value < h->min)
+		value = h->min;
+
+	return value;
+}
+
+int64_t Hist_Mean(const struct histogram *h)
+{
+	return h->count ? h->sum / (int64_t)h->count : 0;
+}
+
+void Hist_WriteCsvHeader(FILE *fp)
+{
+	fprintf(fp, "task,metric,count,min_ns,mean_ns,p50_ns,p99_ns,p99.9_ns,max_ns\n");
+}
+
+void Hist_WriteCsv(FILE *fp, const char *task, const char *metric, const struct histogram *h)
+{
+	fprintf(fp, "%s,%s,%" PRIu64 ",%" PRId64 ",%" PRId64 ",%" PRId64 ",%" PRId64 ",%" PRId64 ",%" PRId64 "\n",
+			task, metric, h->count, h->min, Hist_Mean(h), Hist_Percentile(h, 50.0),
+			Hist_Percentile(h, 99.0), Hist_Percentile(h, 99.9), h->max);
+}
+
+void Hist_WriteCsvBuckets(FILE *fp, const char *task, const char *metric, const struct histogram *h)
+{
+	int i;
+
+	for (i = 0; i < HIST_BUCKETS; i++)
+		if (h->bucket[i])
+			fprintf(fp, "%s,%s,%" PRId64 ",%u\n", task, metric, Hist_BucketMax(i), h->bucket[i]);
+}
+
+void Hist_WriteJson(FILE *fp, const struct histogram *h)
+{
+	int i, first = 1;
+
+	fprintf(fp, "{\"count\": %" PRIu64 ", \"min\": %" PRId64 ", \"mean\": %" PRId64 ", \"p50\": %" PRId64
+				", \"p99\": %" PRId64 ", \"p99.9\": %" PRId64 ", \"max\": %" PRId64 ", \"buckets\": [",
+			h->count, h->min, Hist_Mean(h), Hist_Percentile(h, 50.0), Hist_Percentile(h, 99.0),
+			Hist_Percentile(h, 99.9), h->max);
+
+	/* Non-empty buckets as [upper bound in ns, count] pairs */
+	for (i = 0; i < HIST_BUCKETS; i++)
+	{
+		if (h->bucket[i])
+		{
+			fprintf(fp, "%s[%" PRId64 ", %u]", first ? "" : ", ", Hist_BucketMax(i), h->bucket[i]);
+			first = 0;
+		}
+	}
+	fprintf(fp, "]}");
+}
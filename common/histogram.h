@@ -0,0 +1,67 @@
+/******************************************************************
+ * DETI/UA/IT - Real-Time Operating Systems course
+ *
+ * Fixed-size log-linear histograms of 64-bit nanosecond values.
+ *
+ * Values below 2^HIST_SUB_BITS ns get one bucket each. Above that,
+ * every power of two is split in 2^HIST_SUB_BITS equal buckets, so
+ * the relative error of a bucket is below 2^-HIST_SUB_BITS (~3%).
+ * Values of 2^HIST_MAX_EXP ns (~18 min) or more, and negative
+ * values, are kept in the last/first bucket, but min/max/sum always
+ * hold the exact values. Adding a sample takes constant time and
+ * never allocates memory.
+ *
+ *****************************************************************/
+#ifndef HISTOGRAM_H
+#define HISTOGRAM_H
+
+#include <stdio.h>
+#include <stdint.h>
+
+#define HIST_SUB_BITS 5	 // log2 of the buckets per power of two
+#define HIST_MAX_EXP 40	 // Values up to 2^HIST_MAX_EXP ns are bucketed exactly
+#define HIST_BUCKETS ((HIST_MAX_EXP - HIST_SUB_BITS + 1) << HIST_SUB_BITS)
+
+struct histogram
+{
+	uint64_t count; // Number of samples
+	int64_t min;	// Smallest sample
+	int64_t max;	// Largest sample
+	int64_t sum;	// Sum of all samples (for the mean)
+	uint32_t bucket[HIST_BUCKETS];
+};
+
+/* Empties a histogram */
+void Hist_Init(struct histogram *h);
+
+/* Adds one sample */
+void Hist_Add(struct histogram *h, int64_t value);
+
+/* Adds all samples of src to dst */
+void Hist_Merge(struct histogram *dst, const struct histogram *src);
+
+/*
+ * Returns the value below which "percent" % of the samples lie (upper
+ * bound of the bucket holding that sample, never above the maximum).
+ * Returns 0 for an empty histogram.
+ */
+int64_t Hist_Percentile(const struct histogram *h, double percent);
+
+/* Mean of the samples (0 for an empty histogram) */
+int64_t Hist_Mean(const struct histogram *h);
+
+/* Upper bound of bucket i, in ns */
+int64_t Hist_BucketMax(int i);
+
+/*
+ * Export helpers. Hist_WriteCsvHeader/Hist_WriteCsv write one summary
+ * row per histogram (count, min, mean, p50, p99, p99.9, max);
+ * Hist_WriteCsvBuckets writes one row per non-empty bucket and
+ * Hist_WriteJson writes a JSON object with the summary and buckets.
+ */
+void Hist_WriteCsvHeader(FILE *fp);
+void Hist_WriteCsv(FILE *fp, const char *task, const char *metric, const struct histogram *h);
+void Hist_WriteCsvBuckets(FILE *fp, const char *task, const char *metric, const struct histogram *h);
+void Hist_WriteJson(FILE *fp, const struct histogram *h);
+
+#endif
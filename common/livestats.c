@@ -0,0 +1,167 @@
+/******************************************************************
+ * DETI/UA/IT - Real-Time Operating Systems course
+ *
+ * Live task statistics in shared memory.
+ * See livestats.h
+ *
+ *****************************************************************/
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+
+#if defined(__linux__)
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#endif
+
+#include "livestats.h"
+
+#if !defined(__linux__)
+struct liveStats liveRegion; // Read by the debugger
+#endif
+
+#define READ_ATTEMPTS 100 // Live_Read() gives up after as many updates
+
+/* ***********************************************
+* Publisher
+* ***********************************************/
+
+struct liveStats *Live_Create(const char *name, const char *const *metricNames, int nmetrics)
+{
+	struct liveStats *live;
+	int i;
+#if defined(__linux__)
+	int fd;
+#endif
+
+	if (nmetrics < 0 || nmetrics > LIVE_MAX_METRICS)
+	{
+		errno = EINVAL;
+		return NULL;
+	}
+
+#if defined(__linux__)
+	fd = shm_open(name, O_CREAT | O_RDWR | O_TRUNC, 0644);
+	if (fd < 0)
+		return NULL;
+	if (ftruncate(fd, sizeof(*live)) != 0)
+	{
+		close(fd);
+		return NULL;
+	}
+	live = mmap(NULL, sizeof(*live), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, 0);
+	close(fd);
+	if (live == MAP_FAILED)
+		return NULL;
+	mlock(live, sizeof(*live)); // Best effort, mlockall() may cover it already
+#else
+	(void)name;
+	live = &liveRegion;
+#endif
+
+	/* Readers ignore the region until the magic is set */
+	memset(live, 0, sizeof(*live));
+	live->version = LIVE_VERSION;
+#if defined(__linux__)
+	live->pid = (int32_t)getpid();
+#endif
+	live->nmetrics = (uint32_t)nmetrics;
+	for (i = 0; i < nmetrics; i++)
+		strncpy(live->metricNames[i], metricNames[i], LIVE_NAME_LEN - 1);
+	__atomic_store_n(&live->magic, LIVE_MAGIC, __ATOMIC_RELEASE);
+
+	return live;
+}
+
+void Live_Destroy(struct liveStats *live, const char *name)
+{
+	if (live == NULL)
+		return;
+#if defined(__linux__)
+	munmap(live, sizeof(*live));
+	shm_unlink(name);
+#else
+	(void)name;
+	live->magic = 0;
+#endif
+}
+
+struct liveTask *Live_AddTask(struct liveStats *live, const char *name, int64_t period_ns, int64_t deadline_ns)
+{
+	struct liveTask *t;
+	uint32_t m;
+
+	if (live == NULL || live->ntasks == LIVE_MAX_TASKS)
+		return NULL;
+
+	t = &live->task[live->ntasks];
+	strncpy(t->name, name, LIVE_NAME_LEN - 1);
+	t->period_ns = period_ns;
+	t->deadline_ns = deadline_ns;
+	for (m = 0; m < live->nmetrics; m++)
+		Hist_Init(&t->hist[m]);
+	__atomic_store_n(&live->ntasks, live->ntasks + 1, __ATOMIC_RELEASE);
+
+	return t;
+}
+
+/* ***********************************************
+* Readers
+* ***********************************************/
+
+const struct liveStats *Live_Open(const char *name)
+{
+#if defined(__linux__)
+	const struct liveStats *live;
+	int fd = shm_open(name, O_RDONLY, 0);
+
+	if (fd < 0)
+		return NULL;
+	live = mmap(NULL, sizeof(*live), PROT_READ, MAP_SHARED, fd, 0);
+	close(fd);
+	if (live == MAP_FAILED)
+		return NULL;
+
+	if (__atomic_load_n(&live->magic, __ATOMIC_ACQUIRE) != LIVE_MAGIC || live->version != LIVE_VERSION)
+	{
+		munmap((void *)live, sizeof(*live));
+		errno = EPROTO;
+		return NULL;
+	}
+	return live;
+#else
+	(void)name;
+	return (liveRegion.magic == LIVE_MAGIC ? &liveRegion : NULL);
+#endif
+}
+
+void Live_Close(const struct liveStats *live)
+{
+#if defined(__linux__)
+	if (live != NULL)
+		munmap((void *)live, sizeof(*live));
+#else
+	(void)live;
+#endif
+}
+
+int Live_Read(const struct liveTask *t, struct liveTask *copy)
+{
+	uint32_t s1, s2;
+	int i;
+
+	for (i = 0; i < READ_ATTEMPTS; i++)
+	{
+		s1 = __atomic_load_n(&t->seq, __ATOMIC_ACQUIRE);
+		if (s1 & 1)
+			continue; // Update in progress
+		memcpy(copy, (const void *)t, sizeof(*copy));
+		__atomic_thread_fence(__ATOMIC_ACQUIRE); // The copy completes before the sequence is checked again
+		s2 = __atomic_load_n(&t->seq, __ATOMIC_RELAXED);
+		if (s1 == s2)
+			return 0;
+	}
+
+	return -1;
+}
@@ -0,0 +1,105 @@
+/******************************************************************
+ * DETI/UA/IT - Real-Time Operating Systems course
+ *
+ * Live task statistics in shared memory.
+ *
+ * An RT application publishes the counters and histograms of each
+ * of its tasks in a region that other processes (a monitor such as
+ * rtmon) map read-only and sample at any rate. Each task owns one
+ * slot and updates it in place under a sequence lock: the sequence
+ * is odd while an update is in progress. An update is a few counter
+ * stores and Hist_Add() calls, so the task does constant work per
+ * job and never waits for the readers. A reader copies the slot and
+ * retries if the sequence was odd or changed meanwhile.
+ *
+ * On Linux the region is a POSIX shared memory object
+ * (/dev/shm/NAME), locked in memory. Elsewhere (e.g. FreeRTOS) it is
+ * the static object liveRegion, read with a debugger: shrink
+ * LIVE_MAX_TASKS and LIVE_MAX_METRICS to fit the target.
+ *
+ *****************************************************************/
+#ifndef LIVESTATS_H
+#define LIVESTATS_H
+
+#include <stdint.h>
+
+#include "histogram.h"
+
+#define LIVE_MAGIC 0x4556494Cu // "LIVE"
+#define LIVE_VERSION 1
+
+#ifndef LIVE_MAX_TASKS
+#define LIVE_MAX_TASKS 16
+#endif
+#ifndef LIVE_MAX_METRICS
+#define LIVE_MAX_METRICS 8
+#endif
+#define LIVE_NAME_LEN 16
+
+/* Statistics of one task */
+struct liveTask
+{
+	uint32_t seq;			   // Odd while the task updates the slot
+	char name[LIVE_NAME_LEN];
+	int64_t period_ns;
+	int64_t deadline_ns;
+	uint64_t jobs;			   // Jobs released
+	uint64_t deadlineMisses;
+	uint64_t skipped;		   // Releases skipped (late jobs)
+	struct histogram hist[LIVE_MAX_METRICS];
+};
+
+struct liveStats
+{
+	uint32_t magic;		 // LIVE_MAGIC once the region is set up
+	uint32_t version;	 // LIVE_VERSION
+	int32_t pid;		 // Publishing process
+	uint32_t ntasks;	 // Slots in use
+	uint32_t nmetrics;	 // Histograms in use per task
+	char metricNames[LIVE_MAX_METRICS][LIVE_NAME_LEN];
+	struct liveTask task[LIVE_MAX_TASKS];
+};
+
+/* ***********************************************
+* Publisher
+* ***********************************************/
+
+/*
+ * Creates (or recreates) the region "name" (e.g. "/rtstats") with
+ * the given metrics. Returns the region or NULL on error (errno set).
+ */
+struct liveStats *Live_Create(const char *name, const char *const *metricNames, int nmetrics);
+
+/* Removes the region. The readers keep their mapping until they close it */
+void Live_Destroy(struct liveStats *live, const char *name);
+
+/* Takes the next slot for a task, NULL if none is left. Call before the tasks start */
+struct liveTask *Live_AddTask(struct liveStats *live, const char *name, int64_t period_ns, int64_t deadline_ns);
+
+/* Brackets an update of a slot by its task */
+static inline void Live_Begin(struct liveTask *t)
+{
+	__atomic_store_n(&t->seq, t->seq + 1, __ATOMIC_RELAXED);
+	__atomic_thread_fence(__ATOMIC_RELEASE); // The odd sequence is visible before the data changes
+}
+
+static inline void Live_End(struct liveTask *t)
+{
+	__atomic_store_n(&t->seq, t->seq + 1, __ATOMIC_RELEASE);
+}
+
+/* ***********************************************
+* Readers
+* ***********************************************/
+
+/* Maps the region "name" read-only. Returns NULL on error (errno set) */
+const struct liveStats *Live_Open(const char *name);
+void Live_Close(const struct liveStats *live);
+
+/*
+ * Copies a consistent snapshot of a slot into "copy". Returns 0, or
+ * -1 if the task kept updating it over all the attempts.
+ */
+int Live_Read(const struct liveTask *t, struct liveTask *copy);
+
+#endif
@@ -0,0 +1,342 @@
+/******************************************************************
+ * DETI/UA/IT - Real-Time Operating Systems course
+ *
+ * Interference-workload library. See load.h
+ *
+ *****************************************************************/
+#define _GNU_SOURCE
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+
+#include "load.h"
+#include "rttime.h"
+
+#define CACHE_LINE 64
+
+#define CALIB_MIN_NS (1000 * 1000) // Shortest measurement used to extrapolate
+#define CALIB_RUNS 5			   // Runs per calibration round (median is used)
+#define CALIB_ROUNDS 4			   // Maximum refinement rounds
+#define CALIB_TOLERANCE 0.02	   // Stop refining when within 2% of the target
+
+static const char *loadNames[LOAD_KINDS] = {"fp", "simd", "stream", "chase", "syscall"};
+
+/* ***********************************************
+* Kernels
+* ***********************************************/
+
+/* Integration parameters (those of the former Heavy_Work()) */
+#define LOWER 0.0
+#define UPPER 100.0
+#define f(x) (1.0 / (1.0 + (x) * (x))) /* Define function to integrate*/
+
+// Scalar trapezoid integration, n sub-intervals
+static double Integrate(long n)
+{
+	double stepSize = (UPPER - LOWER) / n, integration, k;
+	long i;
+
+	integration = f(LOWER) + f(UPPER);
+	for (i = 1; i <= n - 1; i++)
+	{
+		k = LOWER + i * stepSize;
+		integration = integration + 2 * f(k);
+	}
+
+	return integration * stepSize / 2;
+}
+
+typedef double v2d __attribute__((vector_size(16)));
+typedef double v4d __attribute__((vector_size(32)));
+
+// Vectorized integration, 2 lanes (SSE2 on x86, generic vectors elsewhere)
+static double IntegrateV2(long n)
+{
+	double stepSize = (UPPER - LOWER) / n, sum = 0;
+	v2d one = {1.0, 1.0}, acc = {0.0, 0.0};
+	v2d k = {LOWER + stepSize, LOWER + 2 * stepSize};
+	v2d inc = {2 * stepSize, 2 * stepSize};
+	long i;
+
+	for (i = 1; i + 1 <= n - 1; i += 2)
+	{
+		acc += one / (one + k * k);
+		k += inc;
+	}
+	for (; i <= n - 1; i++)
+		sum += f(LOWER + i * stepSize);
+	sum += acc[0] + acc[1];
+
+	return (f(LOWER) + f(UPPER) + 2 * sum) * stepSize / 2;
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+// Vectorized integration, 4 lanes, compiled for AVX2
+__attribute__((target("avx2"))) static double IntegrateV4(long n)
+{
+	double stepSize = (UPPER - LOWER) / n, sum = 0;
+	v4d one = {1.0, 1.0, 1.0, 1.0}, acc = {0.0, 0.0, 0.0, 0.0};
+	v4d k = {LOWER + stepSize, LOWER + 2 * stepSize, LOWER + 3 * stepSize, LOWER + 4 * stepSize};
+	v4d inc = {4 * stepSize, 4 * stepSize, 4 * stepSize, 4 * stepSize};
+	long i;
+
+	for (i = 1; i + 3 <= n - 1; i += 4)
+	{
+		acc += one / (one + k * k);
+		k += inc;
+	}
+	for (; i <= n - 1; i++)
+		sum += f(LOWER + i * stepSize);
+	sum += acc[0] + acc[1] + acc[2] + acc[3];
+
+	return (f(LOWER) + f(UPPER) + 2 * sum) * stepSize / 2;
+}
+#endif
+
+// STREAM triad a = b + s * c, "units" elements, resuming where the last run stopped
+static double Stream(struct load *load, long units)
+{
+	size_t n = load->bufSize / (3 * sizeof(double));
+	double *a = load->buf, *b = a + n, *c = b + n;
+	size_t j = load->pos;
+
+	while (units-- > 0)
+	{
+		a[j] = b[j] + 3.0 * c[j];
+		if (++j == n)
+			j = 0;
+	}
+	load->pos = j;
+
+	return a[0];
+}
+
+// Pointer chase, "units" dependent loads
+static void *Chase(void *cursor, long units)
+{
+	void **p = cursor;
+
+	while (units-- > 0)
+		p = *p;
+
+	return p;
+}
+
+// System-call loop, "units" calls (getppid is not cached by the C library)
+static long Syscalls(long units)
+{
+	long r = 0;
+
+	while (units-- > 0)
+		r += syscall(SYS_getppid);
+
+	return r;
+}
+
+/* ***********************************************
+* Working sets
+* ***********************************************/
+
+// Stream buffers: b and c initialised, everything prefaulted
+static int Stream_Init(struct load *load)
+{
+	size_t n = LOAD_STREAM_BYTES / (3 * sizeof(double)), j;
+	double *a;
+
+	load->bufSize = n * 3 * sizeof(double);
+	load->buf = malloc(load->bufSize);
+	if (load->buf == NULL)
+		return -1;
+
+	a = load->buf;
+	for (j = 0; j < n; j++)
+	{
+		a[j] = 0.0;
+		a[n + j] = 1.0;
+		a[2 * n + j] = 2.0;
+	}
+	load->pos = 0;
+
+	return 0;
+}
+
+// One pointer per cache line, linked in a single random cycle (Sattolo's algorithm)
+static int Chase_Init(struct load *load)
+{
+	size_t nodes = LOAD_CHASE_BYTES / CACHE_LINE, i, j, *order;
+	unsigned int seed = 1;
+	char *base;
+
+	load->bufSize = nodes * CACHE_LINE;
+	load->buf = aligned_alloc(CACHE_LINE, load->bufSize);
+	order = malloc(nodes * sizeof(*order));
+	if (load->buf == NULL || order == NULL)
+	{
+		free(load->buf);
+		free(order);
+		load->buf = NULL;
+		return -1;
+	}
+
+	for (i = 0; i < nodes; i++)
+		order[i] = i;
+	for (i = nodes - 1; i > 0; i--)
+	{
+		j = rand_r(&seed) % i; // j < i gives a single cycle
+		size_t tmp = order[i];
+		order[i] = order[j];
+		order[j] = tmp;
+	}
+
+	base = load->buf;
+	for (i = 0; i < nodes; i++)
+		*(void **)(base + order[i] * CACHE_LINE) = base + order[(i + 1) % nodes] * CACHE_LINE;
+	load->cursor = base;
+
+	free(order);
+	return 0;
+}
+
+/* ***********************************************
+* Calibration
+* ***********************************************/
+
+// Median duration of CALIB_RUNS runs of "units" work units
+static int64_t Load_Measure(struct load *load, long units)
+{
+	int64_t t[CALIB_RUNS], tmp;
+	uint64_t start;
+	int i, j;
+
+	for (i = 0; i < CALIB_RUNS; i++)
+	{
+		start = Time_StampStart();
+		Load_RunUnits(load, units);
+		t[i] = Time_StampNs(start, Time_StampEnd());
+	}
+
+	for (i = 1; i < CALIB_RUNS; i++) // Insertion sort, CALIB_RUNS is small
+		for (j = i; j > 0 && t[j] < t[j - 1]; j--)
+			tmp = t[j], t[j] = t[j - 1], t[j - 1] = tmp;
+
+	return t[CALIB_RUNS / 2];
+}
+
+static void Load_Calibrate(struct load *load)
+{
+	int64_t t, floor = load->target_ns < CALIB_MIN_NS ? load->target_ns : CALIB_MIN_NS;
+	double error;
+	long units = 16;
+	int round;
+
+	/* Grow until the run is long enough to be measured reliably */
+	while ((t = Load_Measure(load, units)) < floor && units < (INT64_C(1) << 40) && units <= LONG_MAX / 2)
+		units *= 2;
+
+	/* Then scale to the target and refine */
+	for (round = 0; round < CALIB_ROUNDS; round++)
+	{
+		units = (long)((double)units * load->target_ns / (t > 0 ? t : 1));
+		if (units < 1)
+			units = 1;
+
+		t = Load_Measure(load, units);
+		error = (double)(t - load->target_ns) / load->target_ns;
+		if (error > -CALIB_TOLERANCE && error < CALIB_TOLERANCE)
+			break;
+	}
+
+	load->units = units;
+}
+
+/* ***********************************************
+* Public functions
+* ***********************************************/
+
+int Load_Init(struct load *load, int kind, int64_t target_ns)
+{
+	memset(load, 0, sizeof(*load));
+	load->kind = kind;
+	load->target_ns = target_ns;
+
+	if (kind == LOAD_NONE || target_ns <= 0)
+	{
+		load->kind = LOAD_NONE;
+		return 0;
+	}
+
+	if (kind == LOAD_STREAM && Stream_Init(load) != 0)
+		return -1;
+	if (kind == LOAD_CHASE && Chase_Init(load) != 0)
+		return -1;
+
+	Load_Calibrate(load);
+
+	return 0;
+}
+
+void Load_RunUnits(struct load *load, long units)
+{
+	switch (load->kind)
+	{
+	case LOAD_FP:
+		load->sink = Integrate(units);
+		break;
+	case LOAD_SIMD:
+#if defined(__x86_64__) || defined(__i386__)
+		if (__builtin_cpu_supports("avx2"))
+		{
+			load->sink = IntegrateV4(units);
+			break;
+		}
+#endif
+		load->sink = IntegrateV2(units);
+		break;
+	case LOAD_STREAM:
+		load->sink = Stream(load, units);
+		break;
+	case LOAD_CHASE:
+		load->cursor = Chase(load->cursor, units);
+		break;
+	case LOAD_SYSCALL:
+		load->sink = Syscalls(units);
+		break;
+	}
+}
+
+void Load_Run(struct load *load)
+{
+	if (load->kind != LOAD_NONE)
+		Load_RunUnits(load, load->units);
+}
+
+void Load_Free(struct load *load)
+{
+	free(load->buf);
+	load->buf = NULL;
+	load->kind = LOAD_NONE;
+}
+
+const char *Load_Name(int kind)
+{
+	if (kind < 0 || kind >= LOAD_KINDS)
+		return "none";
+
+	return loadNames[kind];
+}
+
+int Load_Kind(const char *name)
+{
+	int i;
+
+	for (i = 0; i < LOAD_KINDS; i++)
+		if (strcmp(name, loadNames[i]) == 0)
+			return i;
+
+	return LOAD_NONE;
+}
@@ -0,0 +1,75 @@
+/******************************************************************
+ * DETI/UA/IT - Real-Time Operating Systems course
+ *
+ * Interference-workload library: the load executed by each job.
+ *
+ * Kernels:
+ *   fp      - scalar trapezoid integration of 1/(1+x^2) (the former
+ *             Heavy_Work())
+ *   simd    - the same integration vectorized (AVX2 when the CPU
+ *             has it, SSE2/generic vectors otherwise)
+ *   stream  - memory-bandwidth streamer (STREAM triad over a
+ *             working set larger than the last-level cache)
+ *   chase   - cache-thrashing pointer chase over a random cyclic
+ *             permutation of cache lines
+ *   syscall - system-call heavy loop (getppid)
+ *
+ * Load_Init() allocates and prefaults the working set and calibrates
+ * the number of work units so that one Load_Run() lasts the target
+ * duration on the calling CPU. Load_Run() never allocates memory.
+ *
+ *****************************************************************/
+#ifndef LOAD_H
+#define LOAD_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+enum loadKind
+{
+	LOAD_NONE = -1,
+	LOAD_FP,
+	LOAD_SIMD,
+	LOAD_STREAM,
+	LOAD_CHASE,
+	LOAD_SYSCALL,
+	LOAD_KINDS
+};
+
+#define LOAD_STREAM_BYTES (32 * 1024 * 1024) // Working set of the stream kernel
+#define LOAD_CHASE_BYTES (16 * 1024 * 1024)	 // Working set of the pointer chase
+
+struct load
+{
+	int kind;		   // One of enum loadKind
+	int64_t target_ns; // Calibrated duration of Load_Run()
+	long units;		   // Work units per Load_Run() (set by the calibration)
+	void *buf;		   // Working set (stream and chase kernels)
+	size_t bufSize;
+	size_t pos;			// Position of the stream kernel in its working set
+	void *cursor;		// Current node of the pointer chase
+	volatile double sink; // Keeps the compiler from discarding the work
+};
+
+/*
+ * Prepares a load of the given kind lasting target_ns per run.
+ * The calibration is timed with the rttime.h timestamps (TSC if
+ * Time_TscInit() was called before).
+ * Returns 0 on success or -1 if the working set cannot be allocated.
+ */
+int Load_Init(struct load *load, int kind, int64_t target_ns);
+
+/* Executes one run of the load */
+void Load_Run(struct load *load);
+
+/* Runs "units" work units of the load (used by the calibration) */
+void Load_RunUnits(struct load *load, long units);
+
+/* Releases the working set */
+void Load_Free(struct load *load);
+
+/* Kind <-> name conversions. Load_Kind() returns LOAD_NONE if unknown */
+const char *Load_Name(int kind);
+int Load_Kind(const char *name);
+
+#endif
@@ -0,0 +1,71 @@
+/******************************************************************
+ * DETI/UA/IT - Real-Time Operating Systems course
+ *
+ * Overrun policies of periodic tasks.
+ * See overrun.h
+ *
+ *****************************************************************/
+#include <stdio.h>
+#include <string.h>
+
+#include "overrun.h"
+
+static const char *policyNames[] = {"skip", "catchup", "rephase"};
+
+void Overrun_Init(struct overrun *ovr, int policy)
+{
+	memset(ovr, 0, sizeof(*ovr));
+	ovr->policy = policy;
+	ovr->maxCatchUp = OVR_MAX_CATCHUP;
+	Hist_Init(&ovr->burst);
+}
+
+int Overrun_Jobs(struct overrun *ovr, unsigned long missed)
+{
+	unsigned long extra = 0;
+
+	ovr->events++;
+	ovr->missed += missed;
+	Hist_Add(&ovr->burst, (int64_t)missed);
+
+	switch (ovr->policy)
+	{
+	case OVR_CATCHUP:
+		extra = (missed < (unsigned long)ovr->maxCatchUp ? missed : (unsigned long)ovr->maxCatchUp);
+		ovr->caughtUp += extra;
+		break;
+	case OVR_REPHASE:
+		ovr->rephased++;
+		break;
+	}
+	ovr->dropped += missed - extra;
+
+	return 1 + (int)extra;
+}
+
+const char *Overrun_PolicyName(int policy)
+{
+	return (policy >= OVR_SKIP && policy <= OVR_REPHASE ? policyNames[policy] : "?");
+}
+
+int Overrun_Policy(const char *name)
+{
+	int i;
+
+	for (i = OVR_SKIP; i <= OVR_REPHASE; i++)
+		if (strcmp(name, policyNames[i]) == 0)
+			return i;
+
+	return -1;
+}
+
+void Overrun_Print(const char *task, const struct overrun *ovr)
+{
+	printf("Task %s overruns (%s): %llu, releases missed: %llu, caught up: %llu, dropped: %llu, re-phased: %llu\n",
+		   task, Overrun_PolicyName(ovr->policy), (unsigned long long)ovr->events, (unsigned long long)ovr->missed,
+		   (unsigned long long)ovr->caughtUp, (unsigned long long)ovr->dropped, (unsigned long long)ovr->rephased);
+	if (ovr->events > 0)
+		printf("  missed per overrun: min %lld, p50 %lld, p99 %lld, max %lld\n", (long long)ovr->burst.min,
+			   (long long)Hist_Percentile(&ovr->burst, 50.0), (long long)Hist_Percentile(&ovr->burst, 99.0),
+			   (long long)ovr->burst.max);
+}
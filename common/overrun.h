@@ -0,0 +1,66 @@
+/******************************************************************
+ * DETI/UA/IT - Real-Time Operating Systems course
+ *
+ * Overrun policies of periodic tasks.
+ *
+ * When a job runs past one or more releases of its task (e.g. under
+ * a transient load spike), the kernel reports how many releases were
+ * missed (rt_task_wait_period() "overruns" on Xenomai). Instead of
+ * giving up, the task applies one of these policies:
+ *
+ *   OVR_SKIP    - the missed releases are dropped, the task goes on
+ *                 with the current one (no extra load)
+ *   OVR_CATCHUP - one job is run back-to-back per missed release, up
+ *                 to a limit, so that no job is lost
+ *   OVR_REPHASE - the missed releases are dropped and the periodic
+ *                 timeline restarts now (the task re-arms its timer)
+ *
+ * The accounting is kernel independent: the task calls
+ * Overrun_Jobs() with the number of missed releases and runs the
+ * jobs it returns; for OVR_REPHASE it also re-arms its periodic
+ * timer. Every call is counted and the missed releases per overrun
+ * are kept in a histogram.
+ *
+ *****************************************************************/
+#ifndef OVERRUN_H
+#define OVERRUN_H
+
+#include <stdint.h>
+
+#include "histogram.h"
+
+#define OVR_SKIP 0
+#define OVR_CATCHUP 1
+#define OVR_REPHASE 2
+
+#define OVR_MAX_CATCHUP 4 // Default limit of back-to-back jobs after an overrun
+
+struct overrun
+{
+	int policy;			  // OVR_*
+	int maxCatchUp;		  // OVR_CATCHUP: most extra jobs run per overrun
+	uint64_t events;	  // Overruns detected
+	uint64_t missed;	  // Releases missed in total
+	uint64_t caughtUp;	  // Extra jobs run (OVR_CATCHUP)
+	uint64_t dropped;	  // Missed releases without a job
+	uint64_t rephased;	  // Timeline restarts (OVR_REPHASE)
+	struct histogram burst; // Missed releases per overrun
+};
+
+/* Initialises the accounting of a task with the given policy */
+void Overrun_Init(struct overrun *ovr, int policy);
+
+/*
+ * Accounts an overrun of "missed" releases and returns the number of
+ * jobs to run now: 1 for the current release, plus the catch-up jobs.
+ */
+int Overrun_Jobs(struct overrun *ovr, unsigned long missed);
+
+/* Policy names ("skip", "catchup", "rephase"), and back (-1 if unknown) */
+const char *Overrun_PolicyName(int policy);
+int Overrun_Policy(const char *name);
+
+/* Prints the overrun statistics of a task */
+void Overrun_Print(const char *task, const struct overrun *ovr);
+
+#endif
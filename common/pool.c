@@ -0,0 +1,88 @@
+/******************************************************************
+ * DETI/UA/IT - Real-Time Operating Systems course
+ *
+ * Lock-free fixed-block pool allocator.
+ * See pool.h
+ *
+ *****************************************************************/
+#include <stdint.h>
+#include <stddef.h>
+
+#include "pool.h"
+
+#define POOL_NIL 0xFFFFFFFFu // End of the free stack
+
+#define HEAD(tag, index) (((uint64_t)(tag) << 32) | (uint32_t)(index))
+#define HEAD_TAG(head) ((uint32_t)((head) >> 32))
+#define HEAD_INDEX(head) ((uint32_t)(head))
+
+static size_t Round_Up(size_t size)
+{
+	return (size + POOL_ALIGN - 1) & ~(size_t)(POOL_ALIGN - 1);
+}
+
+size_t Pool_Size(size_t blockSize, uint32_t nblocks)
+{
+	return Round_Up(nblocks * sizeof(uint32_t)) + nblocks * Round_Up(blockSize);
+}
+
+int Pool_Init(struct pool *pool, void *mem, size_t blockSize, uint32_t nblocks)
+{
+	uint32_t i;
+
+	if (mem == NULL || blockSize == 0 || nblocks == 0 || nblocks == POOL_NIL || ((uintptr_t)mem % POOL_ALIGN) != 0)
+		return -1;
+
+	pool->next = mem;
+	pool->blocks = (char *)mem + Round_Up(nblocks * sizeof(uint32_t));
+	pool->blockSize = Round_Up(blockSize);
+	pool->nblocks = nblocks;
+	pool->used = pool->maxUsed = pool->failed = 0;
+
+	for (i = 0; i < nblocks; i++)
+		pool->next[i] = (i + 1 < nblocks ? i + 1 : POOL_NIL);
+	pool->head = HEAD(0, 0);
+
+	return 0;
+}
+
+void *Pool_Alloc(struct pool *pool)
+{
+	uint64_t head = __atomic_load_n(&pool->head, __ATOMIC_ACQUIRE);
+	uint32_t index, used, max;
+
+	do
+	{
+		index = HEAD_INDEX(head);
+		if (index == POOL_NIL)
+		{
+			__atomic_add_fetch(&pool->failed, 1, __ATOMIC_RELAXED);
+			return NULL;
+		}
+		/* If another thread took the block meanwhile the tag changed and the CAS fails */
+	} while (!__atomic_compare_exchange_n(&pool->head, &head,
+										  HEAD(HEAD_TAG(head) + 1, __atomic_load_n(&pool->next[index], __ATOMIC_RELAXED)),
+										  1, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE));
+
+	/* Statistics only, a racy high-water mark is good enough */
+	used = __atomic_add_fetch(&pool->used, 1, __ATOMIC_RELAXED);
+	max = __atomic_load_n(&pool->maxUsed, __ATOMIC_RELAXED);
+	if (used > max)
+		__atomic_store_n(&pool->maxUsed, used, __ATOMIC_RELAXED);
+
+	return pool->blocks + (size_t)index * pool->blockSize;
+}
+
+void Pool_Free(struct pool *pool, void *block)
+{
+	uint32_t index = (uint32_t)(((char *)block - pool->blocks) / pool->blockSize);
+	uint64_t head = __atomic_load_n(&pool->head, __ATOMIC_RELAXED);
+
+	do
+	{
+		__atomic_store_n(&pool->next[index], HEAD_INDEX(head), __ATOMIC_RELAXED);
+	} while (!__atomic_compare_exchange_n(&pool->head, &head, HEAD(HEAD_TAG(head) + 1, index),
+										  1, __ATOMIC_RELEASE, __ATOMIC_RELAXED));
+
+	__atomic_sub_fetch(&pool->used, 1, __ATOMIC_RELAXED);
+}
@@ -0,0 +1,49 @@
+/******************************************************************
+ * DETI/UA/IT - Real-Time Operating Systems course
+ *
+ * Lock-free fixed-block pool allocator.
+ *
+ * A pool manages nblocks blocks of blockSize bytes in a caller
+ * supplied memory area (usually preallocated and locked at start-up,
+ * see Pool_Size()). The free blocks form a stack whose head carries
+ * a generation tag, so that Pool_Alloc() and Pool_Free() are
+ * lock-free (one compare-and-swap, no system call) and ABA safe.
+ * Any thread may allocate or free, blocks are 64-byte aligned.
+ *
+ *****************************************************************/
+#ifndef POOL_H
+#define POOL_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define POOL_ALIGN 64 // Block alignment (cache line)
+
+struct pool
+{
+	uint64_t head;		// Free stack: generation tag (high 32 bits), first free block (low 32 bits)
+	uint32_t *next;		// Next free block of each free block
+	char *blocks;		// First block
+	size_t blockSize;	// Block size, rounded up to POOL_ALIGN
+	uint32_t nblocks;	// Number of blocks
+	uint32_t used;		// Blocks currently allocated
+	uint32_t maxUsed;	// High-water mark of "used"
+	uint32_t failed;	// Allocations refused because the pool was empty
+};
+
+/* Bytes of memory needed by a pool of nblocks blocks of blockSize bytes */
+size_t Pool_Size(size_t blockSize, uint32_t nblocks);
+
+/*
+ * Initialises "pool" over "mem", which must hold Pool_Size() bytes
+ * and be POOL_ALIGN aligned. Returns 0 on success, -1 on error.
+ */
+int Pool_Init(struct pool *pool, void *mem, size_t blockSize, uint32_t nblocks);
+
+/* Takes a block from the pool. Returns NULL (and counts it) if empty */
+void *Pool_Alloc(struct pool *pool);
+
+/* Returns a block obtained from Pool_Alloc() to the pool */
+void Pool_Free(struct pool *pool, void *block);
+
+#endif
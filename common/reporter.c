@@ -0,0 +1,112 @@
+/******************************************************************
+ * DETI/UA/IT - Real-Time Operating Systems course
+ *
+ * Non-RT reporter thread. See reporter.h
+ *
+ *****************************************************************/
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+#include <sched.h>
+
+#include "reporter.h"
+
+static struct reportChannel channels[REPORT_MAX_CHANNELS];
+static int nchannels;			// Channels handed out so far
+static reportFormat_t formatFn; // Application format function
+static pthread_t reporterId;
+static volatile int running;
+
+// Formats all pending messages of all channels
+static void Reporter_Drain(void)
+{
+	struct reportChannel *ch;
+	struct reportMsg msg;
+	uint32_t head, dropped;
+	int i, n;
+
+	n = __atomic_load_n(&nchannels, __ATOMIC_ACQUIRE);
+	for (i = 0; i < n; i++)
+	{
+		ch = &channels[i];
+		head = __atomic_load_n(&ch->head, __ATOMIC_ACQUIRE);
+
+		while (ch->tail != head)
+		{
+			msg = ch->ring[ch->tail & (REPORT_RING_SIZE - 1)];
+			__atomic_store_n(&ch->tail, ch->tail + 1, __ATOMIC_RELEASE);
+			formatFn(&msg);
+		}
+
+		dropped = __atomic_load_n(&ch->dropped, __ATOMIC_RELAXED);
+		if (dropped != ch->dropReported)
+		{
+			printf("Reporter: %u messages dropped on channel %d\n\r", dropped - ch->dropReported, i);
+			ch->dropReported = dropped;
+		}
+	}
+	fflush(stdout);
+}
+
+static void *Reporter_code(void *arg)
+{
+	struct timespec poll = {0, REPORT_POLL_MS * 1000 * 1000};
+
+	(void)arg;
+	while (running)
+	{
+		Reporter_Drain();
+		nanosleep(&poll, NULL);
+	}
+	Reporter_Drain(); // Last messages
+
+	return NULL;
+}
+
+int Reporter_Start(reportFormat_t format)
+{
+	pthread_attr_t attr;
+	struct sched_param parm;
+	int err;
+
+	formatFn = format;
+	running = 1;
+
+	/* The reporter is not real-time */
+	pthread_attr_init(&attr);
+	pthread_attr_setinheritsched(&attr, PTHREAD_EXPLICIT_SCHED);
+	pthread_attr_setschedpolicy(&attr, SCHED_OTHER);
+	parm.sched_priority = 0;
+	pthread_attr_setschedparam(&attr, &parm);
+
+	err = pthread_create(&reporterId, &attr, Reporter_code, NULL);
+	pthread_attr_destroy(&attr);
+	if (err != 0)
+		running = 0;
+
+	return err;
+}
+
+void Reporter_Stop(void)
+{
+	if (!running)
+		return;
+
+	running = 0;
+	pthread_join(reporterId, NULL);
+}
+
+struct reportChannel *Reporter_Channel(void)
+{
+	int n = __atomic_load_n(&nchannels, __ATOMIC_ACQUIRE);
+
+	do
+	{
+		if (n >= REPORT_MAX_CHANNELS)
+			return NULL;
+	} while (!__atomic_compare_exchange_n(&nchannels, &n, n + 1, 0, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE));
+
+	return &channels[n];
+}
@@ -0,0 +1,87 @@
+/******************************************************************
+ * DETI/UA/IT - Real-Time Operating Systems course
+ *
+ * Non-RT reporter: moves all formatting and I/O out of the
+ * real-time threads.
+ *
+ * Each RT thread owns a channel, a single-producer/single-consumer
+ * lock-free ring of fixed-size messages. Posting a message is
+ * wait-free and makes no system call: when the ring is full the
+ * message is dropped and counted. A low-priority (SCHED_OTHER)
+ * reporter thread polls all channels and hands every message to an
+ * application supplied format function, which may printf at will.
+ *
+ *****************************************************************/
+#ifndef REPORTER_H
+#define REPORTER_H
+
+#include <stdint.h>
+
+#define REPORT_RING_SIZE 64		// Messages per channel (must be a power of two)
+#define REPORT_MAX_CHANNELS 16	// Maximum number of channels (i.e. RT threads)
+#define REPORT_POLL_MS 20		// Reporter polling period
+#define REPORT_NAME_LEN 16		// Maximum task name length (incl. '\0')
+
+/* A report message. The meaning of the fields is given by "type" and
+ * is only known to the application's format function. Messages are
+ * copied, so a task usually fills "name" once and reuses the message */
+struct reportMsg
+{
+	int type;					// Application defined message type
+	char name[REPORT_NAME_LEN]; // Name of the reporting task
+	int64_t a, b, c;			// Integer arguments
+	double x;					// Floating point argument
+};
+
+/* SPSC channel. head is only written by the producer (RT thread),
+ * tail only by the consumer (reporter thread) */
+struct reportChannel
+{
+	uint32_t head __attribute__((aligned(64)));
+	uint32_t dropped; // Messages lost because the ring was full
+	uint32_t tail __attribute__((aligned(64)));
+	uint32_t dropReported; // Dropped messages already reported
+	struct reportMsg ring[REPORT_RING_SIZE] __attribute__((aligned(64)));
+};
+
+typedef void (*reportFormat_t)(const struct reportMsg *msg);
+
+/*
+ * Starts the reporter thread, which hands each message to "format".
+ * Returns 0 on success or an errno value.
+ */
+int Reporter_Start(reportFormat_t format);
+
+/*
+ * Stops the reporter thread after draining all pending messages.
+ */
+void Reporter_Stop(void);
+
+/*
+ * Allocates a channel for one RT thread (call it at initialisation,
+ * not on the hot path). Returns NULL when all channels are in use.
+ */
+struct reportChannel *Reporter_Channel(void);
+
+/*
+ * Posts a message on a channel. Wait-free, no system calls.
+ * Returns 0 on success or -1 if the message was dropped.
+ */
+static inline int Report_Post(struct reportChannel *ch, const struct reportMsg *msg)
+{
+	uint32_t head = ch->head;
+	uint32_t tail = __atomic_load_n(&ch->tail, __ATOMIC_ACQUIRE);
+
+	if (head - tail == REPORT_RING_SIZE)
+	{
+		__atomic_store_n(&ch->dropped, ch->dropped + 1, __ATOMIC_RELAXED);
+		return -1;
+	}
+
+	ch->ring[head & (REPORT_RING_SIZE - 1)] = *msg;
+	__atomic_store_n(&ch->head, head + 1, __ATOMIC_RELEASE);
+
+	return 0;
+}
+
+#endif
@@ -0,0 +1,130 @@
+/******************************************************************
+ * DETI/UA/IT - Real-Time Operating Systems course
+ *
+ * Cyclic Asynchronous Buffers.
+ * See cab.h
+ *
+ *****************************************************************/
+#include <assert.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+#if defined(RTAPI_FREERTOS)
+#include "FreeRTOS.h"
+#include "task.h"
+#endif
+
+#include "cab.h"
+
+#define CAB_NONE 0xFFFFFFFFu	 // Reader holds no buffer
+#define CAB_PENDING 0xFFFFFFFEu // Reader is taking the mrb (lock-free variant)
+
+#define BUF(cab, i) ((cab)->buffers + (size_t)(i) * (cab)->stride)
+
+static size_t Round_Up(size_t size)
+{
+	return (size + CAB_ALIGN - 1) & ~(size_t)(CAB_ALIGN - 1);
+}
+
+size_t Cab_Size(size_t size, int nreaders)
+{
+	return (size_t)(nreaders + CAB_EXTRA) * Round_Up(size);
+}
+
+int Cab_Init(struct cab *cab, void *mem, size_t size, int nreaders, const void *init)
+{
+	int i;
+
+	if (mem == NULL || size == 0 || nreaders < 1 || nreaders > CAB_MAX_READERS || ((uintptr_t)mem % CAB_ALIGN) != 0)
+		return -1;
+
+	cab->buffers = mem;
+	cab->size = size;
+	cab->stride = Round_Up(size);
+	cab->nbuffers = (uint32_t)(nreaders + CAB_EXTRA);
+	cab->nreaders = nreaders;
+	cab->helped = 0;
+	for (i = 0; i < CAB_MAX_READERS; i++)
+		cab->held[i] = CAB_NONE;
+
+	memcpy(BUF(cab, 0), init, size);
+	cab->mrb = 0;
+	return 0;
+}
+
+void *Cab_Reserve(struct cab *cab)
+{
+	uint32_t mrb = cab->mrb; // Only the writer changes it
+	uint32_t b;
+	int i;
+
+	/* One of the nbuffers is neither the mrb nor held by one of the readers */
+	for (b = (mrb + 1) % cab->nbuffers; b != mrb; b = (b + 1) % cab->nbuffers)
+	{
+		for (i = 0; i < cab->nreaders; i++)
+			if (__atomic_load_n(&cab->held[i], __ATOMIC_SEQ_CST) == b)
+				break;
+		if (i == cab->nreaders)
+			break;
+	}
+	assert(b != mrb);
+
+	return BUF(cab, b);
+}
+
+void Cab_Put(struct cab *cab, void *buf)
+{
+	uint32_t b = (uint32_t)(((char *)buf - cab->buffers) / cab->stride);
+
+#if defined(RTAPI_FREERTOS)
+	taskENTER_CRITICAL();
+	cab->mrb = b;
+	taskEXIT_CRITICAL();
+#else
+	uint32_t pending;
+	int i;
+
+	/* Orders the message before, and the next Cab_Reserve() scan after, the new mrb */
+	__atomic_store_n(&cab->mrb, b, __ATOMIC_SEQ_CST);
+
+	/* Pending readers may have read an older mrb: give them this one */
+	for (i = 0; i < cab->nreaders; i++)
+	{
+		pending = CAB_PENDING;
+		if (__atomic_compare_exchange_n(&cab->held[i], &pending, b, 0, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST))
+			__atomic_add_fetch(&cab->helped, 1, __ATOMIC_RELAXED);
+	}
+#endif
+}
+
+const void *Cab_Get(struct cab *cab, int reader)
+{
+	uint32_t b;
+
+#if defined(RTAPI_FREERTOS)
+	taskENTER_CRITICAL();
+	b = cab->mrb;
+	cab->held[reader] = b;
+	taskEXIT_CRITICAL();
+#else
+	uint32_t pending = CAB_PENDING;
+
+	/*
+	 * If the swap succeeds, no Cab_Put() finished in between (it would
+	 * have replaced the pending mark), so b was still the mrb and is now
+	 * announced. Otherwise the writer announced a newer mrb for us
+	 */
+	__atomic_store_n(&cab->held[reader], CAB_PENDING, __ATOMIC_SEQ_CST);
+	b = __atomic_load_n(&cab->mrb, __ATOMIC_SEQ_CST);
+	if (!__atomic_compare_exchange_n(&cab->held[reader], &pending, b, 0, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST))
+		b = pending;
+#endif
+
+	return BUF(cab, b);
+}
+
+void Cab_Unget(struct cab *cab, int reader)
+{
+	__atomic_store_n(&cab->held[reader], CAB_NONE, __ATOMIC_RELEASE);
+}
@@ -0,0 +1,81 @@
+/******************************************************************
+ * DETI/UA/IT - Real-Time Operating Systems course
+ *
+ * Cyclic Asynchronous Buffers (CABs): non-blocking state sharing
+ * between a writer task and up to CAB_MAX_READERS reader tasks of
+ * different rates.
+ *
+ * The writer reserves a free buffer, fills it and publishes it as
+ * the most recent buffer (mrb). A reader takes the mrb, reads it in
+ * place and releases it. Readers always see the latest complete
+ * message (never a partially written one) and neither side ever
+ * blocks: a buffer is only reused by the writer when it is neither
+ * the mrb nor held by a reader.
+ *
+ * POSIX and Alchemy: wait-free, a constant number of steps on both
+ * sides besides the writer's scan of the N readers. A reader marks
+ * itself pending, reads the mrb and announces it with a compare and
+ * swap of the pending mark. After publishing, the writer announces
+ * the new mrb for every reader it finds pending (helping), so a
+ * reader whose swap fails uses the buffer the writer gave it instead
+ * of retrying. The writer skips the mrb and every announced buffer.
+ *
+ * FreeRTOS: a reader takes and announces the mrb inside a critical
+ * section of a few instructions.
+ *
+ * In both cases a reader keeps its buffer after newer messages are
+ * published, so N readers can hold N buffers besides the mrb and the
+ * writer needs one more: N + 2 buffers.
+ *
+ *****************************************************************/
+#ifndef CAB_H
+#define CAB_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "rtapi.h"
+
+#define CAB_MAX_READERS 8
+
+#define CAB_EXTRA 2 // Buffers besides the readers' ones (see above)
+
+#define CAB_ALIGN 64 // Buffer alignment (cache line)
+
+struct cab
+{
+	uint32_t mrb;						// Most recent buffer
+	uint32_t held[CAB_MAX_READERS];		// Buffer announced by each reader (CAB_NONE: none)
+	char *buffers;						// nbuffers buffers of "size" bytes (rounded to CAB_ALIGN)
+	size_t size, stride;
+	uint32_t nbuffers;
+	int nreaders;
+	uint32_t helped;					// Reads announced by the writer (wait-free variant)
+};
+
+/* Bytes of memory needed by a CAB of messages of "size" bytes for nreaders readers */
+size_t Cab_Size(size_t size, int nreaders);
+
+/*
+ * Initialises a CAB over "mem" (Cab_Size() bytes, CAB_ALIGN aligned),
+ * with "init" as its first message, so that readers always get one.
+ * Returns 0 on success, -1 on error.
+ */
+int Cab_Init(struct cab *cab, void *mem, size_t size, int nreaders, const void *init);
+
+/* Writer: returns a free buffer for the next message. Never fails, never blocks */
+void *Cab_Reserve(struct cab *cab);
+
+/* Writer: publishes the buffer from Cab_Reserve() as the most recent message */
+void Cab_Put(struct cab *cab, void *buf);
+
+/*
+ * Reader "reader" (0..nreaders-1): returns the most recent message,
+ * valid (and unchanged) until Cab_Unget(). One message per reader.
+ */
+const void *Cab_Get(struct cab *cab, int reader);
+
+/* Reader: releases the message from Cab_Get() */
+void Cab_Unget(struct cab *cab, int reader);
+
+#endif
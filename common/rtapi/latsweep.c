@@ -0,0 +1,290 @@
+/******************************************************************
+ * DETI/UA/IT - Real-Time Operating Systems course
+ *
+ * Scheduling latency sweep on the portable RT task API.
+ *
+ * The acceptance test for a new kernel or board: in the spirit of
+ * the Xenomai "latency" tool, an idle periodic task measures its
+ * wake-up latency (actual minus intended release) for every
+ * combination of
+ *
+ *   - period:   50 us .. 100 ms
+ *   - priority: above and below the background load
+ *   - load:     0 .. 75% of the CPU, taken by a periodic task of
+ *               medium priority running a calibrated workload
+ *
+ * all on one CPU. Each point runs for the given time (or at least
+ * MIN_JOBS releases) and a summary table of the latency histograms
+ * is printed at the end. Periods the backend cannot release (e.g.
+ * below the FreeRTOS tick) are reported as such.
+ *
+ * Usage: latsweep_BACKEND [-d SECONDS] [-c CPU] [-o PREFIX]
+ *   -o: histograms to PREFIX.csv (summary) and PREFIX_hist.csv (buckets)
+ *
+ *****************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+
+#include "rtapi.h"
+#include "load.h"
+#include "histogram.h"
+
+#define US_2_NS(us) ((int64_t)(us) * 1000)
+#define MS_2_NS(ms) ((int64_t)(ms) * 1000 * 1000)
+
+#define START_DELAY_NS MS_2_NS(50) // From the start semaphore to the first release
+#define MIN_JOBS 100			   // Releases measured per point, at least
+#define LOAD_PERIOD_NS MS_2_NS(10) // Period of the background load task
+#define LOAD_PRIO (RTAPI_PRIO_MAX / 2)
+
+static const int64_t periods[] = {US_2_NS(50), US_2_NS(100), US_2_NS(250), US_2_NS(500), MS_2_NS(1), MS_2_NS(10), MS_2_NS(100)};
+static const int priorities[] = {RTAPI_PRIO_MAX, LOAD_PRIO / 2}; // Above and below the load
+static const int loads[] = {0, 25, 50, 75};						 // % of the CPU
+
+#define NPERIODS ((int)(sizeof(periods) / sizeof(periods[0])))
+#define NPRIOS ((int)(sizeof(priorities) / sizeof(priorities[0])))
+#define NLOADS ((int)(sizeof(loads) / sizeof(loads[0])))
+#define NPOINTS (NPERIODS * NPRIOS * NLOADS)
+
+/* Result of one point of the sweep */
+struct point
+{
+	int64_t period_ns;
+	int priority, load;
+	int err; // RtTask_SetPeriodic() error, 0 if measured
+	uint64_t overruns;
+	struct histogram wakeup;
+};
+
+static struct point points[NPOINTS];
+static struct rtTask probe, loadTask;
+static struct load loadWork[NLOADS];
+static struct rtSem startSem;
+static int64_t start_ns, probePeriod;
+static int probeErr;
+static volatile int stop;
+static int duration = 2, cpu = 0;
+static const char *outPrefix; // -o
+
+// The measured task: does nothing but wait for its releases
+static void Probe_code(void *arg)
+{
+	(void)arg;
+
+	RtSem_Wait(&startSem);
+	probeErr = RtTask_SetPeriodic(&probe, start_ns, probePeriod);
+	if (probeErr != 0)
+		return;
+
+	while (!stop)
+		if (RtTask_WaitPeriod(&probe) < 0)
+			break;
+}
+
+// The background load: runs its workload every LOAD_PERIOD_NS
+static void Load_code(void *arg)
+{
+	struct load *work = arg;
+
+	RtSem_Wait(&startSem);
+	if (RtTask_SetPeriodic(&loadTask, start_ns, LOAD_PERIOD_NS) != 0)
+		return;
+
+	while (!stop)
+	{
+		if (RtTask_WaitPeriod(&loadTask) < 0)
+			break;
+		Load_Run(work);
+	}
+}
+
+// Measures one point of the sweep. Returns 0 or a negative error code
+static int Run_Point(struct point *pt, int loadIndex)
+{
+	int64_t run = MS_2_NS(duration * 1000);
+	int err, ntasks = 1;
+
+	/* Long periods: enough releases for the high percentiles */
+	if (run < (MIN_JOBS + RTAPI_BOOT_JOBS) * pt->period_ns)
+		run = (MIN_JOBS + RTAPI_BOOT_JOBS) * pt->period_ns;
+
+	stop = 0;
+	probePeriod = pt->period_ns;
+	err = RtTask_Create(&probe, "probe", pt->priority, cpu, Probe_code, NULL);
+	if (err != 0)
+		return err;
+	if (pt->load > 0)
+	{
+		err = RtTask_Create(&loadTask, "load", LOAD_PRIO, cpu, Load_code, &loadWork[loadIndex]);
+		if (err != 0)
+		{
+			/* Releases the probe, which exits at once */
+			stop = 1;
+			start_ns = RtApi_Now();
+			RtSem_Post(&startSem);
+			RtTask_Join(&probe);
+			return err;
+		}
+		ntasks++;
+	}
+
+	start_ns = RtApi_Now() + START_DELAY_NS;
+	while (ntasks-- > 0)
+		RtSem_Post(&startSem);
+
+	RtApi_Sleep(START_DELAY_NS + run);
+	stop = 1;
+	RtTask_Join(&probe);
+	if (pt->load > 0)
+		RtTask_Join(&loadTask);
+
+	pt->err = probeErr;
+	pt->overruns = probe.stats.overruns;
+	pt->wakeup = probe.stats.wakeup;
+	return 0;
+}
+
+// Writes the histograms of all points to PREFIX.csv and PREFIX_hist.csv. Returns 0 on success
+static int Export_Points(const char *prefix)
+{
+	char path[256], label[64];
+	FILE *summary, *buckets;
+	int i;
+
+	snprintf(path, sizeof(path), "%s.csv", prefix);
+	summary = fopen(path, "w");
+	if (summary == NULL)
+	{
+		printf("Cannot write %s: %s\n", path, strerror(errno));
+		return -1;
+	}
+	snprintf(path, sizeof(path), "%s_hist.csv", prefix);
+	buckets = fopen(path, "w");
+	if (buckets == NULL)
+	{
+		printf("Cannot write %s: %s\n", path, strerror(errno));
+		fclose(summary);
+		return -1;
+	}
+
+	Hist_WriteCsvHeader(summary);
+	fprintf(buckets, "task,metric,bucket_max_ns,count\n");
+	for (i = 0; i < NPOINTS; i++)
+	{
+		if (points[i].err != 0)
+			continue;
+		snprintf(label, sizeof(label), "p%ldus_prio%d_load%d", (long)(points[i].period_ns / 1000), points[i].priority,
+				 points[i].load);
+		Hist_WriteCsv(summary, label, "wakeup", &points[i].wakeup);
+		Hist_WriteCsvBuckets(buckets, label, "wakeup", &points[i].wakeup);
+	}
+
+	fclose(summary);
+	fclose(buckets);
+	return 0;
+}
+
+// Prints the summary table (us)
+static void Print_Points(void)
+{
+	const struct point *pt;
+	int i;
+
+	printf("\nWake-up latency (us), %s backend\n", RtApi_Backend());
+	printf("%10s %5s %5s %8s %9s %9s %9s %9s %9s %9s\n", "period_us", "prio", "load%", "samples", "min", "mean", "p50",
+		   "p99", "p99.9", "max");
+	for (i = 0; i < NPOINTS; i++)
+	{
+		pt = &points[i];
+		printf("%10ld %5d %5d", (long)(pt->period_ns / 1000), pt->priority, pt->load);
+		if (pt->err != 0)
+		{
+			printf("   period not supported by the backend [%d]\n", pt->err);
+			continue;
+		}
+		printf(" %8lu %9.1f %9.1f %9.1f %9.1f %9.1f %9.1f", (unsigned long)pt->wakeup.count, pt->wakeup.min / 1e3,
+			   Hist_Mean(&pt->wakeup) / 1e3, Hist_Percentile(&pt->wakeup, 50.0) / 1e3,
+			   Hist_Percentile(&pt->wakeup, 99.0) / 1e3, Hist_Percentile(&pt->wakeup, 99.9) / 1e3,
+			   pt->wakeup.max / 1e3);
+		if (pt->overruns > 0)
+			printf("  %lu overruns", (unsigned long)pt->overruns);
+		printf("\n");
+	}
+}
+
+// The main activity: runs the whole sweep and reports it
+static int App(void *arg)
+{
+	int p, q, l, n = 0, err, ret = -1;
+
+	(void)arg;
+	printf("rtapi backend: %s, CPU %d, %d points of at least %d s, load task priority %d\n", RtApi_Backend(), cpu,
+		   NPOINTS, duration, LOAD_PRIO);
+
+	for (l = 0; l < NLOADS; l++)
+		if (Load_Init(&loadWork[l], LOAD_FP, LOAD_PERIOD_NS * loads[l] / 100) != 0)
+		{
+			printf("Cannot allocate the background workload\n");
+			goto error;
+		}
+	RtSem_Init(&startSem, 0);
+
+	for (p = 0; p < NPERIODS; p++)
+		for (q = 0; q < NPRIOS; q++)
+			for (l = 0; l < NLOADS; l++, n++)
+			{
+				points[n].period_ns = periods[p];
+				points[n].priority = priorities[q];
+				points[n].load = loads[l];
+				printf("[%2d/%d] period %ld us, priority %d, load %d%%\n", n + 1, NPOINTS, (long)(periods[p] / 1000),
+					   priorities[q], loads[l]);
+
+				err = Run_Point(&points[n], l);
+				if (err != 0)
+				{
+					printf("Error creating the tasks [%d]\n", err);
+					RtSem_Destroy(&startSem);
+					goto error;
+				}
+			}
+	RtSem_Destroy(&startSem);
+
+	Print_Points();
+	if (outPrefix == NULL || Export_Points(outPrefix) == 0)
+		ret = 0;
+
+error:
+	for (l = 0; l < NLOADS; l++)
+		Load_Free(&loadWork[l]);
+
+	return ret;
+}
+
+int main(int argc, char *argv[])
+{
+	int opt;
+
+	while ((opt = getopt(argc, argv, "d:c:o:")) != -1)
+	{
+		switch (opt)
+		{
+		case 'd':
+			duration = atoi(optarg);
+			break;
+		case 'c':
+			cpu = atoi(optarg);
+			break;
+		case 'o':
+			outPrefix = optarg;
+			break;
+		default:
+			printf("Usage: %s [-d SECONDS] [-c CPU] [-o PREFIX]\n", argv[0]);
+			return -1;
+		}
+	}
+
+	return RtApi_Main(App, NULL);
+}
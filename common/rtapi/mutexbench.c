@@ -0,0 +1,241 @@
+/******************************************************************
+ * DETI/UA/IT - Real-Time Operating Systems course
+ *
+ * Mutex protocol benchmark on the portable RT task API.
+ *
+ * The classic priority inversion scenario, with the three tasks of
+ * the Xenomai A3 sample pinned to one CPU: the low priority task L
+ * locks a mutex for a long critical section, the high priority task
+ * H is released and needs the same mutex, and the medium priority
+ * task M (which does not use it) is released right after H blocked.
+ * Without a protocol M delays L, and so H, for as long as it runs.
+ * With priority inheritance or an immediate ceiling, H waits at
+ * most for the rest of the critical section of L.
+ *
+ * Each protocol available on the backend (see RtMutex_Init()) runs
+ * for the given time. The blocking time of H (from its release to
+ * the mutex acquisition) and its response time (from its release to
+ * the end of the job) are summarised per protocol.
+ *
+ * Usage: mutexbench_BACKEND [-d SECONDS] [-c CPU]
+ *
+ *****************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "rtapi.h"
+#include "load.h"
+#include "histogram.h"
+
+#define MS_2_NS(ms) ((int64_t)(ms) * 1000 * 1000)
+
+#define START_DELAY_NS MS_2_NS(100) // From the start semaphore to the first release
+#define PERIOD_MS 50				// Common period (and hyperperiod) of the tasks
+
+/* The scenario, repeated every period */
+static const struct
+{
+	const char *name;
+	int priority; // 1..RTAPI_PRIO_MAX
+	int phase_ms; // Release within the period
+	int cs_ms;	  // Critical section (0: does not lock the mutex)
+	int load_ms;  // Work outside the critical section
+} taskSet[] = {
+	{"H", 30, 1, 1, 0},
+	{"M", 20, 2, 0, 10},
+	{"L", 10, 0, 4, 0},
+};
+
+#define NTASKS ((int)(sizeof(taskSet) / sizeof(taskSet[0])))
+#define TASK_H 0
+
+struct benchTask
+{
+	struct rtTask task;
+	struct load cs, load;
+	int index; // In taskSet[]
+};
+
+static struct benchTask tasks[NTASKS];
+static struct rtMutex mutex;
+static struct rtSem startSem;
+static int64_t start_ns;
+static volatile int stop;
+static int duration = 5, cpu = 0;
+
+/* Measurements of H, per protocol */
+static struct histogram blocking[RTMUTEX_PROTECT + 1], response[RTMUTEX_PROTECT + 1];
+static int protocol;
+
+static void Task_code(void *arg)
+{
+	struct benchTask *t = arg;
+	int64_t release, acquired = 0;
+
+	RtSem_Wait(&startSem);
+	if (RtTask_SetPeriodic(&t->task, start_ns + MS_2_NS(taskSet[t->index].phase_ms), MS_2_NS(PERIOD_MS)) != 0)
+	{
+		printf("Task %s: invalid period\n", t->task.name);
+		return;
+	}
+
+	while (!stop)
+	{
+		if (RtTask_WaitPeriod(&t->task) < 0)
+			break;
+		release = t->task.stats.release_ns;
+
+		if (taskSet[t->index].cs_ms > 0)
+		{
+			RtMutex_Lock(&mutex);
+			acquired = RtApi_Now();
+			Load_Run(&t->cs);
+			RtMutex_Unlock(&mutex);
+		}
+		if (taskSet[t->index].load_ms > 0)
+			Load_Run(&t->load);
+
+		if (t->index == TASK_H && t->task.stats.jobs > RTAPI_BOOT_JOBS)
+		{
+			Hist_Add(&blocking[protocol], acquired - release);
+			Hist_Add(&response[protocol], RtApi_Now() - release);
+		}
+	}
+}
+
+// Runs the scenario with the current protocol. Returns 0, -ENOTSUP or another error code
+static int Run_Protocol(void)
+{
+	int i, err;
+
+	err = RtMutex_Init(&mutex, protocol, taskSet[TASK_H].priority);
+	if (err != 0)
+		return err;
+
+	stop = 0;
+	for (i = 0; i < NTASKS; i++)
+	{
+		err = RtTask_Create(&tasks[i].task, taskSet[i].name, taskSet[i].priority, cpu, Task_code, &tasks[i]);
+		if (err != 0)
+		{
+			printf("Error creating task %s [%d]\n", taskSet[i].name, err);
+			break;
+		}
+	}
+	if (err != 0)
+	{
+		/* Releases the tasks already created, which exit at once */
+		stop = 1;
+		start_ns = RtApi_Now();
+		while (i-- > 0)
+		{
+			RtSem_Post(&startSem);
+			RtTask_Join(&tasks[i].task);
+		}
+		RtMutex_Destroy(&mutex);
+		return err;
+	}
+
+	/* Common time origin */
+	start_ns = RtApi_Now() + START_DELAY_NS;
+	for (i = 0; i < NTASKS; i++)
+		RtSem_Post(&startSem);
+
+	RtApi_Sleep(MS_2_NS(duration * 1000));
+	stop = 1;
+	for (i = 0; i < NTASKS; i++)
+		RtTask_Join(&tasks[i].task);
+	RtMutex_Destroy(&mutex);
+
+	return 0;
+}
+
+// Prints a summary line of a histogram (us)
+static void Print_Us(const struct histogram *h)
+{
+	printf(" %9.1f %9.1f %9.1f %9.1f", Hist_Percentile(h, 50.0) / 1e3, Hist_Percentile(h, 99.0) / 1e3,
+		   Hist_Percentile(h, 99.9) / 1e3, h->max / 1e3);
+}
+
+// The main activity: runs the scenario with every protocol and prints the results
+static int App(void *arg)
+{
+	int i, err, avail[RTMUTEX_PROTECT + 1];
+
+	(void)arg;
+	printf("rtapi backend: %s, %d s per protocol, CPU %d\n", RtApi_Backend(), duration, cpu);
+	for (i = 0; i < NTASKS; i++)
+		printf("  Task %s: priority %d, phase %d ms, critical section %d ms, other work %d ms, period %d ms\n",
+			   taskSet[i].name, taskSet[i].priority, taskSet[i].phase_ms, taskSet[i].cs_ms, taskSet[i].load_ms, PERIOD_MS);
+
+	for (i = 0; i < NTASKS; i++)
+	{
+		tasks[i].index = i;
+		if (Load_Init(&tasks[i].cs, LOAD_FP, MS_2_NS(taskSet[i].cs_ms)) != 0 ||
+			Load_Init(&tasks[i].load, LOAD_FP, MS_2_NS(taskSet[i].load_ms)) != 0)
+		{
+			printf("Task %s: cannot allocate the workload\n", taskSet[i].name);
+			return -1;
+		}
+	}
+	RtSem_Init(&startSem, 0);
+
+	for (protocol = RTMUTEX_NONE; protocol <= RTMUTEX_PROTECT; protocol++)
+	{
+		Hist_Init(&blocking[protocol]);
+		Hist_Init(&response[protocol]);
+		printf("Protocol %s ...\n", RtMutex_Protocol(protocol));
+
+		err = Run_Protocol();
+		avail[protocol] = (err == 0);
+		if (err != 0)
+			printf("  not available on this backend [%d]\n", err);
+	}
+	RtSem_Destroy(&startSem);
+
+	/* H alone would take cs_ms: any excess is blocking (plus the wake-up latency) */
+	printf("\n%-16s %-39s %s\n", "Task H (us)", "blocking", "response");
+	printf("%-9s %6s %9s %9s %9s %9s %9s %9s %9s %9s\n", "protocol", "jobs", "p50", "p99", "p99.9", "max", "p50", "p99",
+		   "p99.9", "max");
+	for (protocol = RTMUTEX_NONE; protocol <= RTMUTEX_PROTECT; protocol++)
+	{
+		if (!avail[protocol])
+			continue;
+		printf("%-9s %6lu", RtMutex_Protocol(protocol), (unsigned long)blocking[protocol].count);
+		Print_Us(&blocking[protocol]);
+		Print_Us(&response[protocol]);
+		printf("\n");
+	}
+
+	for (i = 0; i < NTASKS; i++)
+	{
+		Load_Free(&tasks[i].cs);
+		Load_Free(&tasks[i].load);
+	}
+
+	return 0;
+}
+
+int main(int argc, char *argv[])
+{
+	int opt;
+
+	while ((opt = getopt(argc, argv, "d:c:")) != -1)
+	{
+		switch (opt)
+		{
+		case 'd':
+			duration = atoi(optarg);
+			break;
+		case 'c':
+			cpu = atoi(optarg);
+			break;
+		default:
+			printf("Usage: %s [-d SECONDS] [-c CPU]\n", argv[0]);
+			return -1;
+		}
+	}
+
+	return RtApi_Main(App, NULL);
+}
@@ -0,0 +1,172 @@
+/******************************************************************
+ * DETI/UA/IT - Real-Time Operating Systems course
+ *
+ * Zero-copy data-flow pipelines between precedence-linked tasks.
+ * See pipeline.h
+ *
+ *****************************************************************/
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+#include "pipeline.h"
+
+#define RING_MASK (PIPE_RING_SIZE - 1)
+
+/* Frame header, in front of the data (which stays cache line aligned) */
+struct frameHdr
+{
+	struct pipeline *owner; // Pipeline whose pool holds the frame
+	uint32_t refs;			// Stages (and producer) still holding the frame
+	uint64_t seq;			// Publication order
+	int64_t time_ns;		// Publication time
+};
+
+#define HDR_SIZE POOL_ALIGN
+
+_Static_assert(sizeof(struct frameHdr) <= HDR_SIZE, "frame header larger than HDR_SIZE");
+_Static_assert((PIPE_RING_SIZE & RING_MASK) == 0, "PIPE_RING_SIZE must be a power of two");
+
+#define HDR(frame) ((struct frameHdr *)((char *)(frame) - HDR_SIZE))
+
+size_t Pipe_Size(size_t frameSize, uint32_t nframes)
+{
+	return Pool_Size(HDR_SIZE + frameSize, nframes);
+}
+
+int Pipe_Init(struct pipeline *pipe, void *mem, size_t frameSize, uint32_t nframes)
+{
+	if (mem == NULL && nframes == 0)
+		memset(&pipe->pool, 0, sizeof(pipe->pool)); // Forwarding only
+	else if (Pool_Init(&pipe->pool, mem, HDR_SIZE + frameSize, nframes) != 0)
+		return -1;
+
+	pipe->frameSize = frameSize;
+	pipe->nstages = 0;
+	pipe->noFrame = 0;
+	pipe->seq = 0;
+	return 0;
+}
+
+int Stage_Init(struct pipeStage *stage)
+{
+	stage->head = stage->tail = 0;
+	stage->dropped = 0;
+	return RtSem_Init(&stage->release, 0);
+}
+
+void Stage_Destroy(struct pipeStage *stage)
+{
+	RtSem_Destroy(&stage->release);
+}
+
+int Pipe_Connect(struct pipeline *pipe, struct pipeStage *stage)
+{
+	if (pipe->nstages == PIPE_MAX_FANOUT)
+		return -1;
+
+	pipe->stage[pipe->nstages++] = stage;
+	return 0;
+}
+
+void *Pipe_Acquire(struct pipeline *pipe)
+{
+	char *block = (pipe->pool.nblocks > 0 ? Pool_Alloc(&pipe->pool) : NULL);
+
+	if (block == NULL)
+	{
+		pipe->noFrame++;
+		return NULL;
+	}
+
+	((struct frameHdr *)block)->owner = pipe;
+	return block + HDR_SIZE;
+}
+
+// Queues a frame on a stage and releases its task (single producer per stage)
+static int Stage_Push(struct pipeStage *stage, void *frame)
+{
+	uint32_t head = stage->head;
+
+	if (head - __atomic_load_n(&stage->tail, __ATOMIC_ACQUIRE) == PIPE_RING_SIZE)
+	{
+		stage->dropped++;
+		return -1;
+	}
+
+	stage->ring[head & RING_MASK] = frame;
+	__atomic_store_n(&stage->head, head + 1, __ATOMIC_RELEASE);
+	RtSem_Post(&stage->release);
+	return 0;
+}
+
+// Hands a frame over to the stages of "pipe"; the caller holds a reference meanwhile
+static int Pipe_Deliver(struct pipeline *pipe, void *frame)
+{
+	int i, n = 0;
+
+	for (i = 0; i < pipe->nstages; i++)
+	{
+		if (Stage_Push(pipe->stage[i], frame) == 0)
+			n++;
+		else
+			__atomic_sub_fetch(&HDR(frame)->refs, 1, __ATOMIC_RELAXED); // Never the last one
+	}
+
+	return n;
+}
+
+int Pipe_Publish(struct pipeline *pipe, void *frame)
+{
+	struct frameHdr *hdr = HDR(frame);
+	int n;
+
+	hdr->seq = ++pipe->seq;
+	hdr->time_ns = RtApi_Now();
+
+	/* One reference per stage, plus the producer's until all are delivered */
+	__atomic_store_n(&hdr->refs, pipe->nstages + 1, __ATOMIC_RELAXED);
+	n = Pipe_Deliver(pipe, frame);
+	Pipe_Release(frame);
+
+	return n;
+}
+
+int Pipe_Forward(struct pipeline *next, void *frame)
+{
+	__atomic_add_fetch(&HDR(frame)->refs, next->nstages, __ATOMIC_RELAXED);
+	return Pipe_Deliver(next, frame);
+}
+
+void *Stage_Wait(struct pipeStage *stage)
+{
+	uint32_t tail = stage->tail;
+	void *frame;
+
+	if (RtSem_Wait(&stage->release) != 0)
+		return NULL;
+
+	/* The post follows the push, so the ring is not empty */
+	frame = stage->ring[tail & RING_MASK];
+	__atomic_store_n(&stage->tail, tail + 1, __ATOMIC_RELEASE);
+	return frame;
+}
+
+void Pipe_Release(void *frame)
+{
+	struct frameHdr *hdr = HDR(frame);
+
+	/* Release: the consumer's reads happen before the frame is reused */
+	if (__atomic_sub_fetch(&hdr->refs, 1, __ATOMIC_ACQ_REL) == 0)
+		Pool_Free(&hdr->owner->pool, hdr);
+}
+
+uint64_t Pipe_FrameSeq(const void *frame)
+{
+	return HDR(frame)->seq;
+}
+
+int64_t Pipe_FrameTime(const void *frame)
+{
+	return HDR(frame)->time_ns;
+}
@@ -0,0 +1,107 @@
+/******************************************************************
+ * DETI/UA/IT - Real-Time Operating Systems course
+ *
+ * Zero-copy data-flow pipelines between precedence-linked tasks.
+ *
+ * A pipeline owns a pool of preallocated frames (see pool.h). The
+ * producer job acquires a frame, fills it in place and publishes it:
+ * a reference to the frame is queued on every consumer stage
+ * connected to the pipeline and each consumer task is released
+ * (semaphore post) with it. Nothing is copied, and a frame fanned out
+ * to N consumers carries a reference count of N. Each consumer
+ * releases its reference when done, and the last one returns the
+ * frame to the pool.
+ *
+ * A consumer may pass a frame on to a further pipeline without
+ * copying it (Pipe_Forward(), e.g. an in-place filter in a
+ * sensor -> filter -> control chain). The frame stays in the pool
+ * of its producer until its last reference is released.
+ *
+ * Each stage must be fed by a single producer task. Frames are
+ * released from any task. Publishing and releasing are lock-free
+ * and never block. When the pool is empty (all frames still in use)
+ * or a stage queue is full, the frame or delivery is dropped and
+ * counted.
+ *
+ *****************************************************************/
+#ifndef PIPELINE_H
+#define PIPELINE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "rtapi.h"
+#include "pool.h"
+
+#define PIPE_MAX_FANOUT 8 // Consumer stages per pipeline
+#define PIPE_RING_SIZE 16 // Frames queued per stage (power of two)
+
+/* Consumer endpoint of a pipeline, owned by one consumer task */
+struct pipeStage
+{
+	struct rtSem release;			 // Posted once per queued frame
+	uint32_t head, tail;			 // SPSC ring of frames (head: producer, tail: consumer)
+	void *ring[PIPE_RING_SIZE];
+	uint32_t dropped;				 // Frames lost because the ring was full
+};
+
+struct pipeline
+{
+	struct pool pool;								// Frames
+	size_t frameSize;								// Usable bytes per frame
+	struct pipeStage *stage[PIPE_MAX_FANOUT];		// Connected consumers
+	int nstages;
+	uint32_t noFrame;								// Pipe_Acquire() failures (pool empty)
+	uint64_t seq;									// Frames published
+};
+
+/* Bytes of memory needed by a pipeline of nframes frames of frameSize bytes */
+size_t Pipe_Size(size_t frameSize, uint32_t nframes);
+
+/*
+ * Initialises a pipeline over "mem" (Pipe_Size() bytes, POOL_ALIGN
+ * aligned). A pipeline with no frames (mem NULL, nframes 0) only
+ * forwards frames of other pipelines. Returns 0 on success, -1 on
+ * error.
+ */
+int Pipe_Init(struct pipeline *pipe, void *mem, size_t frameSize, uint32_t nframes);
+
+/* Initialises a consumer stage. Returns 0 or a negative error code */
+int Stage_Init(struct pipeStage *stage);
+void Stage_Destroy(struct pipeStage *stage);
+
+/* Connects a stage to a pipeline (before the tasks start). Returns 0 or -1 */
+int Pipe_Connect(struct pipeline *pipe, struct pipeStage *stage);
+
+/* Producer: takes a free frame, NULL if none (counted in pipe->noFrame) */
+void *Pipe_Acquire(struct pipeline *pipe);
+
+/*
+ * Producer: hands "frame" (from Pipe_Acquire()) over to all stages
+ * of the pipeline and releases them. The producer must not touch
+ * the frame afterwards. Returns the number of stages reached.
+ */
+int Pipe_Publish(struct pipeline *pipe, void *frame);
+
+/*
+ * Consumer: passes a received frame on to the stages of "next",
+ * without copying it. The caller still owns (and must release) its
+ * own reference. Returns the number of stages reached.
+ */
+int Pipe_Forward(struct pipeline *next, void *frame);
+
+/*
+ * Consumer: waits until the stage is released with a frame and
+ * returns it (NULL on error). The frame is shared read-only with the
+ * other consumers, unless the stage is its only one.
+ */
+void *Stage_Wait(struct pipeStage *stage);
+
+/* Drops one reference to a frame, the last one frees it */
+void Pipe_Release(void *frame);
+
+/* Sequence number of a frame (order of publication, from 1) and its publication time (ns) */
+uint64_t Pipe_FrameSeq(const void *frame);
+int64_t Pipe_FrameTime(const void *frame);
+
+#endif
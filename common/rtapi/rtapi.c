@@ -0,0 +1,58 @@
+/******************************************************************
+ * DETI/UA/IT - Real-Time Operating Systems course
+ *
+ * Portable real-time task API: backend independent part (the
+ * statistics). See rtapi.h
+ *
+ *****************************************************************/
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+
+#include "rtapi.h"
+
+const char *RtMutex_Protocol(int protocol)
+{
+	static const char *names[] = {"none", "inherit", "protect"};
+
+	return (protocol >= RTMUTEX_NONE && protocol <= RTMUTEX_PROTECT ? names[protocol] : "?");
+}
+
+void RtStats_Init(struct rtStats *stats)
+{
+	memset(stats, 0, sizeof(*stats));
+	Hist_Init(&stats->wakeup);
+	Hist_Init(&stats->exec);
+}
+
+void RtStats_Release(struct rtStats *stats, int64_t end_ns, int64_t release_ns, int64_t now_ns, int missed)
+{
+	/* The job that just ended */
+	if (end_ns != 0 && stats->jobs > RTAPI_BOOT_JOBS)
+		Hist_Add(&stats->exec, end_ns - stats->start_ns);
+
+	/* The new release */
+	stats->jobs++;
+	stats->overruns += missed;
+	if (stats->jobs > RTAPI_BOOT_JOBS)
+		Hist_Add(&stats->wakeup, now_ns - release_ns);
+	stats->release_ns = release_ns;
+	stats->start_ns = now_ns;
+}
+
+// Prints one line of statistics of a histogram
+static void Print_Hist(const char *metric, const struct histogram *h)
+{
+	printf("  %-10s %10lu %12ld %12ld %12ld %12ld %12ld %12ld\n", metric, (unsigned long)h->count, (long)h->min,
+		   (long)Hist_Mean(h), (long)Hist_Percentile(h, 50.0), (long)Hist_Percentile(h, 99.0),
+		   (long)Hist_Percentile(h, 99.9), (long)h->max);
+}
+
+void RtStats_Print(const struct rtTask *task)
+{
+	printf("Task %s (%s): period %ld ns, priority %d, %lu jobs, %lu overruns\n", task->name, RtApi_Backend(),
+		   (long)task->period_ns, task->priority, (unsigned long)task->stats.jobs, (unsigned long)task->stats.overruns);
+	printf("  %-10s %10s %12s %12s %12s %12s %12s %12s\n", "(ns)", "samples", "min", "mean", "p50", "p99", "p99.9", "max");
+	Print_Hist("wakeup", &task->stats.wakeup);
+	Print_Hist("exec", &task->stats.exec);
+}
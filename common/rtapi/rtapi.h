@@ -0,0 +1,214 @@
+/******************************************************************
+ * DETI/UA/IT - Real-Time Operating Systems course
+ *
+ * Portable real-time task API.
+ *
+ * One periodic-task interface (tasks, periods, semaphores, mutexes,
+ * affinity and per-task statistics) over three kernels, selected at compile
+ * time:
+ *
+ *   RTAPI_POSIX    - pthreads, SCHED_FIFO, clock_nanosleep (default)
+ *   RTAPI_ALCHEMY  - Xenomai 3 Alchemy skin (Cobalt or Mercury)
+ *   RTAPI_FREERTOS - FreeRTOS (POSIX/Linux simulator port)
+ *
+ * The statistics are gathered by the API itself, identically on all
+ * backends, so that the kernels can be compared head-to-head:
+ * RtTask_WaitPeriod() records the wake-up latency of every release
+ * (actual minus intended release time) and the execution time of
+ * the job that just ended (from its release to the call).
+ *
+ * Times are int64_t ns. Priorities are 1 (lowest) to RTAPI_PRIO_MAX
+ * and are mapped onto the native range of each kernel.
+ *
+ *****************************************************************/
+#ifndef RTAPI_H
+#define RTAPI_H
+
+#include <stdint.h>
+
+#include "histogram.h"
+
+#if !defined(RTAPI_POSIX) && !defined(RTAPI_ALCHEMY) && !defined(RTAPI_FREERTOS)
+#define RTAPI_POSIX
+#endif
+
+#if defined(RTAPI_ALCHEMY)
+#include <pthread.h>
+#include <alchemy/task.h>
+#include <alchemy/sem.h>
+#include <alchemy/mutex.h>
+#elif defined(RTAPI_FREERTOS)
+#include "FreeRTOS.h"
+#include "task.h"
+#include "semphr.h"
+#else
+#include <pthread.h>
+#include <semaphore.h>
+#endif
+
+#define RTAPI_NAME_LEN 16	// Maximum task name length (incl. '\0')
+#define RTAPI_PRIO_MAX 32	// Highest priority
+#define RTAPI_BOOT_JOBS 10	// Jobs ignored by the statistics (warm-up)
+
+/* Mutex protocols */
+#define RTMUTEX_NONE 0		// None: a medium priority task can block a high one indefinitely
+#define RTMUTEX_INHERIT 1	// Priority inheritance
+#define RTMUTEX_PROTECT 2	// Immediate priority ceiling
+
+/* Per-task statistics, maintained by RtTask_WaitPeriod() */
+struct rtStats
+{
+	uint64_t jobs;			  // Releases
+	uint64_t overruns;		  // Releases missed because a job was late
+	struct histogram wakeup;  // Wake-up latency
+	struct histogram exec;	  // Execution time
+	int64_t release_ns;		  // Intended time of the last release
+	int64_t start_ns;		  // Actual time of the last release
+};
+
+typedef void (*rtEntry_t)(void *arg);
+
+struct rtTask
+{
+	char name[RTAPI_NAME_LEN];
+	int priority;		// 1..RTAPI_PRIO_MAX
+	int cpu;			// CPU the task is pinned to (-1: no affinity)
+	rtEntry_t entry;	// Task body and its argument
+	void *arg;
+	int64_t period_ns;	// 0 until RtTask_SetPeriodic()
+	int64_t next_ns;	// Next release
+	struct rtStats stats;
+
+	/* Backend specific */
+#if defined(RTAPI_ALCHEMY)
+	RT_TASK task;
+#elif defined(RTAPI_FREERTOS)
+	TaskHandle_t handle;
+	SemaphoreHandle_t done; // Given when the body returns (join)
+	TickType_t lastWake;	// vTaskDelayUntil() reference
+#else
+	pthread_t thread;
+#endif
+};
+
+struct rtSem
+{
+#if defined(RTAPI_ALCHEMY)
+	RT_SEM sem;
+#elif defined(RTAPI_FREERTOS)
+	SemaphoreHandle_t sem;
+#else
+	sem_t sem;
+#endif
+};
+
+struct rtMutex
+{
+	int protocol; // RTMUTEX_*
+#if defined(RTAPI_ALCHEMY)
+	RT_SEM sem;			   // RTMUTEX_NONE
+	RT_MUTEX mutex;		   // RTMUTEX_INHERIT (always inherits)
+	pthread_mutex_t pmutex; // RTMUTEX_PROTECT (Cobalt POSIX)
+#elif defined(RTAPI_FREERTOS)
+	SemaphoreHandle_t sem;
+	UBaseType_t ceiling; // RTMUTEX_PROTECT: native priority of the ceiling
+	UBaseType_t saved;	 // and of the owner before it locked
+#else
+	pthread_mutex_t mutex;
+#endif
+};
+
+/* ***********************************************
+* Run-time
+* ***********************************************/
+
+/*
+ * Runs "app" as the main (non-RT) activity of the application and
+ * returns its result. Memory is locked first. On FreeRTOS "app"
+ * runs in a task and the scheduler is started (and stopped when
+ * "app" returns). Call once, from main().
+ */
+int RtApi_Main(int (*app)(void *arg), void *arg);
+
+/* Name of the backend ("posix", "alchemy" or "freertos") */
+const char *RtApi_Backend(void);
+
+/* Current time (ns, monotonic) */
+int64_t RtApi_Now(void);
+
+/* Sleeps for "ns" nanoseconds (non-RT use, e.g. the main activity) */
+void RtApi_Sleep(int64_t ns);
+
+/* ***********************************************
+* Tasks
+* ***********************************************/
+
+/*
+ * Creates and starts a task running entry(arg) with the given
+ * priority, pinned to "cpu" (-1: any CPU). Returns 0 or a negative
+ * error code.
+ */
+int RtTask_Create(struct rtTask *task, const char *name, int priority, int cpu, rtEntry_t entry, void *arg);
+
+/*
+ * Makes the calling task periodic: first release at start_ns
+ * (absolute, 0 = now), then every period_ns. Returns 0 or a negative
+ * error code.
+ */
+int RtTask_SetPeriodic(struct rtTask *task, int64_t start_ns, int64_t period_ns);
+
+/*
+ * Ends the current job and waits for the next release of the
+ * calling task. Returns the number of releases missed meanwhile
+ * (0 if the task kept up) or a negative error code.
+ */
+int RtTask_WaitPeriod(struct rtTask *task);
+
+/* Waits for the task body to return */
+int RtTask_Join(struct rtTask *task);
+
+/* ***********************************************
+* Semaphores (counting, priority ordered where supported)
+* ***********************************************/
+
+int RtSem_Init(struct rtSem *sem, unsigned int count);
+int RtSem_Wait(struct rtSem *sem);
+int RtSem_Post(struct rtSem *sem);
+void RtSem_Destroy(struct rtSem *sem);
+
+/* ***********************************************
+* Mutexes
+* ***********************************************/
+
+/*
+ * Initialises a mutex with the given protocol. "ceiling" is the
+ * highest RTAPI priority of the tasks that lock it (RTMUTEX_PROTECT
+ * only). Returns 0, -ENOTSUP if the backend lacks the protocol, or
+ * another negative error code.
+ */
+int RtMutex_Init(struct rtMutex *mutex, int protocol, int ceiling);
+int RtMutex_Lock(struct rtMutex *mutex);
+int RtMutex_Unlock(struct rtMutex *mutex);
+void RtMutex_Destroy(struct rtMutex *mutex);
+
+/* Name of a mutex protocol */
+const char *RtMutex_Protocol(int protocol);
+
+/* ***********************************************
+* Statistics (common to all backends, see rtapi.c)
+* ***********************************************/
+
+/* Resets the statistics of a task */
+void RtStats_Init(struct rtStats *stats);
+
+/*
+ * Accounts the job that ended at end_ns (0: none yet) and the next
+ * release, intended at release_ns and seen at now_ns, after "missed"
+ * releases were skipped. Called by the backends.
+ */
+void RtStats_Release(struct rtStats *stats, int64_t end_ns, int64_t release_ns, int64_t now_ns, int missed);
+
+/* Prints the statistics of a task (times in ns) */
+void RtStats_Print(const struct rtTask *task);
+
+#endif
@@ -0,0 +1,248 @@
+/******************************************************************
+ * DETI/UA/IT - Real-Time Operating Systems course
+ *
+ * Portable real-time task API: Xenomai 3 Alchemy backend. Builds
+ * against Cobalt (dual kernel) and Mercury (plain Linux) alike, see
+ * the Makefile. Times are ns: the Alchemy clock must have the
+ * default 1 ns resolution. See rtapi.h
+ *
+ *****************************************************************/
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+#include <alchemy/task.h>
+#include <alchemy/timer.h>
+#include <alchemy/sem.h>
+#include <alchemy/mutex.h>
+
+#include "rtapi.h"
+
+#define PRIO_BASE 40 // Alchemy priority of RTAPI priority 0
+
+static RT_TASK mainTask; // The main activity, shadowed as a low priority Alchemy task
+
+static void Task_Trampoline(void *arg)
+{
+	struct rtTask *task = arg;
+
+	task->entry(task->arg);
+}
+
+/* ***********************************************
+* Run-time
+* ***********************************************/
+
+int RtApi_Main(int (*app)(void *arg), void *arg)
+{
+	int err;
+
+	mlockall(MCL_CURRENT | MCL_FUTURE);
+
+	/* Alchemy services are only available to Xenomai threads */
+	err = rt_task_shadow(&mainTask, "main", 0, 0);
+	if (err != 0)
+	{
+		printf("Cannot shadow the main thread [%s]\n", strerror(-err));
+		return err;
+	}
+
+	return app(arg);
+}
+
+const char *RtApi_Backend(void)
+{
+	return "alchemy";
+}
+
+int64_t RtApi_Now(void)
+{
+	return (int64_t)rt_timer_read();
+}
+
+void RtApi_Sleep(int64_t ns)
+{
+	rt_task_sleep((RTIME)ns);
+}
+
+/* ***********************************************
+* Tasks
+* ***********************************************/
+
+int RtTask_Create(struct rtTask *task, const char *name, int priority, int cpu, rtEntry_t entry, void *arg)
+{
+	int mode = T_JOINABLE;
+	int err;
+
+	if (priority < 1 || priority > RTAPI_PRIO_MAX)
+		return -EINVAL;
+
+	memset(task, 0, sizeof(*task));
+	strncpy(task->name, name, RTAPI_NAME_LEN - 1);
+	task->priority = priority;
+	task->cpu = cpu;
+	task->entry = entry;
+	task->arg = arg;
+	RtStats_Init(&task->stats);
+
+	if (cpu >= 0)
+		mode |= T_CPU(cpu);
+
+	err = rt_task_create(&task->task, task->name, 0, PRIO_BASE + priority, mode);
+	if (err != 0)
+		return err;
+
+	err = rt_task_start(&task->task, Task_Trampoline, task);
+	if (err != 0)
+		rt_task_delete(&task->task);
+	return err;
+}
+
+int RtTask_SetPeriodic(struct rtTask *task, int64_t start_ns, int64_t period_ns)
+{
+	int err;
+
+	if (period_ns <= 0)
+		return -EINVAL;
+
+	task->period_ns = period_ns;
+	task->next_ns = (start_ns != 0 ? start_ns : RtApi_Now());
+	err = rt_task_set_periodic(NULL, start_ns != 0 ? (RTIME)start_ns : TM_NOW, (RTIME)period_ns);
+
+	return err;
+}
+
+int RtTask_WaitPeriod(struct rtTask *task)
+{
+	int64_t end = (task->stats.jobs > 0 ? RtApi_Now() : 0);
+	unsigned long overruns = 0;
+	int64_t now;
+	int err;
+
+	/* -ETIMEDOUT: the task is released, but overruns releases were missed */
+	err = rt_task_wait_period(&overruns);
+	if (err != 0 && err != -ETIMEDOUT)
+		return err;
+	now = RtApi_Now();
+
+	task->next_ns += (int64_t)overruns * task->period_ns;
+	RtStats_Release(&task->stats, end, task->next_ns, now, (int)overruns);
+	task->next_ns += task->period_ns;
+
+	return (int)overruns;
+}
+
+int RtTask_Join(struct rtTask *task)
+{
+	return rt_task_join(&task->task);
+}
+
+/* ***********************************************
+* Semaphores
+* ***********************************************/
+
+int RtSem_Init(struct rtSem *sem, unsigned int count)
+{
+	return rt_sem_create(&sem->sem, NULL, count, S_PRIO);
+}
+
+int RtSem_Wait(struct rtSem *sem)
+{
+	return rt_sem_p(&sem->sem, TM_INFINITE);
+}
+
+int RtSem_Post(struct rtSem *sem)
+{
+	return rt_sem_v(&sem->sem);
+}
+
+void RtSem_Destroy(struct rtSem *sem)
+{
+	rt_sem_delete(&sem->sem);
+}
+
+/* ***********************************************
+* Mutexes
+* ***********************************************/
+
+/*
+ * rt_mutex always inherits priority, so RTMUTEX_NONE is a binary
+ * semaphore and RTMUTEX_PROTECT a Cobalt POSIX mutex (Xenomai 3.1 or
+ * later), which Alchemy tasks may lock as well.
+ */
+int RtMutex_Init(struct rtMutex *mutex, int protocol, int ceiling)
+{
+	pthread_mutexattr_t attr;
+	int err;
+
+	mutex->protocol = protocol;
+	switch (protocol)
+	{
+	case RTMUTEX_NONE:
+		return rt_sem_create(&mutex->sem, NULL, 1, S_PRIO);
+	case RTMUTEX_INHERIT:
+		return rt_mutex_create(&mutex->mutex, NULL);
+	case RTMUTEX_PROTECT:
+/* PTHREAD_PRIO_PROTECT is an enum constant: test the POSIX option instead */
+#if defined(_POSIX_THREAD_PRIO_PROTECT) && _POSIX_THREAD_PRIO_PROTECT >= 0
+		pthread_mutexattr_init(&attr);
+		err = pthread_mutexattr_setprotocol(&attr, PTHREAD_PRIO_PROTECT);
+		if (err == 0)
+			err = pthread_mutexattr_setprioceiling(&attr, PRIO_BASE + ceiling);
+		if (err == 0)
+			err = pthread_mutex_init(&mutex->pmutex, &attr);
+		pthread_mutexattr_destroy(&attr);
+		return -err;
+#else
+		(void)attr;
+		(void)err;
+		return -ENOTSUP;
+#endif
+	default:
+		return -EINVAL;
+	}
+}
+
+int RtMutex_Lock(struct rtMutex *mutex)
+{
+	switch (mutex->protocol)
+	{
+	case RTMUTEX_NONE:
+		return rt_sem_p(&mutex->sem, TM_INFINITE);
+	case RTMUTEX_INHERIT:
+		return rt_mutex_acquire(&mutex->mutex, TM_INFINITE);
+	default:
+		return -pthread_mutex_lock(&mutex->pmutex);
+	}
+}
+
+int RtMutex_Unlock(struct rtMutex *mutex)
+{
+	switch (mutex->protocol)
+	{
+	case RTMUTEX_NONE:
+		return rt_sem_v(&mutex->sem);
+	case RTMUTEX_INHERIT:
+		return rt_mutex_release(&mutex->mutex);
+	default:
+		return -pthread_mutex_unlock(&mutex->pmutex);
+	}
+}
+
+void RtMutex_Destroy(struct rtMutex *mutex)
+{
+	switch (mutex->protocol)
+	{
+	case RTMUTEX_NONE:
+		rt_sem_delete(&mutex->sem);
+		break;
+	case RTMUTEX_INHERIT:
+		rt_mutex_delete(&mutex->mutex);
+		break;
+	default:
+		pthread_mutex_destroy(&mutex->pmutex);
+	}
+}
@@ -0,0 +1,263 @@
+/******************************************************************
+ * DETI/UA/IT - Real-Time Operating Systems course
+ *
+ * Portable real-time task API: FreeRTOS backend, for the POSIX
+ * (Linux simulator) port. Releases are tick based (vTaskDelayUntil),
+ * the measurements use CLOCK_MONOTONIC of the host, so the wake-up
+ * latency includes the tick quantisation. On a target without
+ * clock_gettime(), RtApi_Now() must be mapped onto a hardware timer
+ * (e.g. the PIC32 core timer). See rtapi.h
+ *
+ *****************************************************************/
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+
+#include "FreeRTOS.h"
+#include "task.h"
+#include "semphr.h"
+
+#include "rtapi.h"
+#include "rttime.h"
+
+#define TASK_STACK (configMINIMAL_STACK_SIZE * 2) // Stack of the RTAPI tasks (words)
+#define APP_PRIORITY (tskIDLE_PRIORITY + 1)		  // The main activity, below all RTAPI tasks
+#define SEM_MAX_COUNT 0x7FFF					  // Counting semaphore limit
+
+#define TICK_NS (1000000000LL / configTICK_RATE_HZ)
+
+#if configMAX_PRIORITIES < RTAPI_PRIO_MAX + 2
+#error "configMAX_PRIORITIES must be at least RTAPI_PRIO_MAX + 2"
+#endif
+
+/* The main activity */
+static int (*appFunc)(void *arg);
+static void *appArg;
+static int appResult;
+
+static void App_Task(void *arg)
+{
+	(void)arg;
+	appResult = appFunc(appArg);
+	vTaskEndScheduler();
+}
+
+static void Task_Trampoline(void *arg)
+{
+	struct rtTask *task = arg;
+
+	task->entry(task->arg);
+	xSemaphoreGive(task->done);
+	vTaskDelete(NULL);
+}
+
+/* ***********************************************
+* Run-time
+* ***********************************************/
+
+int RtApi_Main(int (*app)(void *arg), void *arg)
+{
+	appFunc = app;
+	appArg = arg;
+
+	if (xTaskCreate(App_Task, "main", TASK_STACK, NULL, APP_PRIORITY, NULL) != pdPASS)
+		return -ENOMEM;
+
+	/* Returns when App_Task() ends the scheduler */
+	vTaskStartScheduler();
+	return appResult;
+}
+
+const char *RtApi_Backend(void)
+{
+	return "freertos";
+}
+
+int64_t RtApi_Now(void)
+{
+	return Time_Now();
+}
+
+void RtApi_Sleep(int64_t ns)
+{
+	vTaskDelay((TickType_t)((ns + TICK_NS - 1) / TICK_NS));
+}
+
+/* ***********************************************
+* Tasks
+* ***********************************************/
+
+int RtTask_Create(struct rtTask *task, const char *name, int priority, int cpu, rtEntry_t entry, void *arg)
+{
+	if (priority < 1 || priority > RTAPI_PRIO_MAX)
+		return -EINVAL;
+#if !defined(configUSE_CORE_AFFINITY) || configUSE_CORE_AFFINITY == 0
+	if (cpu > 0)
+		return -EINVAL; // Single core kernel
+#endif
+
+	memset(task, 0, sizeof(*task));
+	strncpy(task->name, name, RTAPI_NAME_LEN - 1);
+	task->priority = priority;
+	task->cpu = cpu;
+	task->entry = entry;
+	task->arg = arg;
+	RtStats_Init(&task->stats);
+
+	task->done = xSemaphoreCreateBinary();
+	if (task->done == NULL)
+		return -ENOMEM;
+
+	if (xTaskCreate(Task_Trampoline, task->name, TASK_STACK, task, APP_PRIORITY + priority, &task->handle) != pdPASS)
+	{
+		vSemaphoreDelete(task->done);
+		return -ENOMEM;
+	}
+#if defined(configUSE_CORE_AFFINITY) && configUSE_CORE_AFFINITY == 1
+	if (cpu >= 0)
+		vTaskCoreAffinitySet(task->handle, 1u << cpu);
+#endif
+
+	return 0;
+}
+
+int RtTask_SetPeriodic(struct rtTask *task, int64_t start_ns, int64_t period_ns)
+{
+	int64_t now = RtApi_Now();
+	int64_t delay = 0;
+
+	/* Releases are ticks */
+	if (period_ns < TICK_NS || period_ns % TICK_NS != 0)
+		return -EINVAL;
+	if (start_ns > now)
+		delay = (start_ns - now + TICK_NS - 1) / TICK_NS;
+
+	task->period_ns = period_ns;
+	task->next_ns = (start_ns != 0 ? start_ns : now);
+
+	/* vTaskDelayUntil() wakes up at lastWake + period */
+	task->lastWake = xTaskGetTickCount() + (TickType_t)delay - (TickType_t)(period_ns / TICK_NS);
+	return 0;
+}
+
+int RtTask_WaitPeriod(struct rtTask *task)
+{
+	int64_t end = (task->stats.jobs > 0 ? RtApi_Now() : 0);
+	TickType_t period = (TickType_t)(task->period_ns / TICK_NS);
+	int64_t now;
+	int missed = 0;
+
+	if (task->period_ns == 0)
+		return -EINVAL;
+
+	/* vTaskDelayUntil() would catch up on the releases already gone: skip them */
+	if (end - task->next_ns >= task->period_ns && end != 0)
+	{
+		missed = (int)((end - task->next_ns) / task->period_ns);
+		task->next_ns += missed * task->period_ns;
+		task->lastWake += (TickType_t)missed * period;
+	}
+
+	vTaskDelayUntil(&task->lastWake, period);
+	now = RtApi_Now();
+
+	RtStats_Release(&task->stats, end, task->next_ns, now, missed);
+	task->next_ns += task->period_ns;
+
+	return missed;
+}
+
+int RtTask_Join(struct rtTask *task)
+{
+	xSemaphoreTake(task->done, portMAX_DELAY);
+	vSemaphoreDelete(task->done);
+	return 0;
+}
+
+/* ***********************************************
+* Semaphores
+* ***********************************************/
+
+int RtSem_Init(struct rtSem *sem, unsigned int count)
+{
+	sem->sem = xSemaphoreCreateCounting(SEM_MAX_COUNT, count);
+	return sem->sem != NULL ? 0 : -ENOMEM;
+}
+
+int RtSem_Wait(struct rtSem *sem)
+{
+	return xSemaphoreTake(sem->sem, portMAX_DELAY) == pdTRUE ? 0 : -EAGAIN;
+}
+
+int RtSem_Post(struct rtSem *sem)
+{
+	return xSemaphoreGive(sem->sem) == pdTRUE ? 0 : -EOVERFLOW;
+}
+
+void RtSem_Destroy(struct rtSem *sem)
+{
+	vSemaphoreDelete(sem->sem);
+}
+
+/* ***********************************************
+* Mutexes
+* ***********************************************/
+
+/*
+ * RTMUTEX_NONE is a binary semaphore, RTMUTEX_INHERIT a FreeRTOS
+ * mutex. FreeRTOS has no ceiling protocol: RTMUTEX_PROTECT raises
+ * the owner to the ceiling while it holds a binary semaphore
+ * (immediate ceiling, single core).
+ */
+int RtMutex_Init(struct rtMutex *mutex, int protocol, int ceiling)
+{
+	if (protocol < RTMUTEX_NONE || protocol > RTMUTEX_PROTECT)
+		return -EINVAL;
+
+	mutex->protocol = protocol;
+	mutex->ceiling = APP_PRIORITY + ceiling;
+	if (protocol == RTMUTEX_INHERIT)
+		mutex->sem = xSemaphoreCreateMutex();
+	else
+	{
+		mutex->sem = xSemaphoreCreateBinary();
+		if (mutex->sem != NULL)
+			xSemaphoreGive(mutex->sem);
+	}
+
+	return mutex->sem != NULL ? 0 : -ENOMEM;
+}
+
+int RtMutex_Lock(struct rtMutex *mutex)
+{
+	UBaseType_t saved = uxTaskPriorityGet(NULL);
+
+	if (mutex->protocol == RTMUTEX_PROTECT)
+		vTaskPrioritySet(NULL, mutex->ceiling);
+	if (xSemaphoreTake(mutex->sem, portMAX_DELAY) != pdTRUE)
+	{
+		if (mutex->protocol == RTMUTEX_PROTECT)
+			vTaskPrioritySet(NULL, saved);
+		return -EAGAIN;
+	}
+	mutex->saved = saved;
+
+	return 0;
+}
+
+int RtMutex_Unlock(struct rtMutex *mutex)
+{
+	UBaseType_t saved = mutex->saved;
+
+	if (xSemaphoreGive(mutex->sem) != pdTRUE)
+		return -EPERM;
+	if (mutex->protocol == RTMUTEX_PROTECT)
+		vTaskPrioritySet(NULL, saved);
+
+	return 0;
+}
+
+void RtMutex_Destroy(struct rtMutex *mutex)
+{
+	vSemaphoreDelete(mutex->sem);
+}
@@ -0,0 +1,209 @@
+/******************************************************************
+ * DETI/UA/IT - Real-Time Operating Systems course
+ *
+ * Portable real-time task API: POSIX backend (pthreads, SCHED_FIFO,
+ * absolute clock_nanosleep releases). See rtapi.h
+ *
+ *****************************************************************/
+#define _GNU_SOURCE
+#include <sched.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <pthread.h>
+#include <semaphore.h>
+#include <sys/mman.h>
+
+#include "rtapi.h"
+#include "rttime.h"
+
+#define PRIO_BASE 40 // SCHED_FIFO priority of RTAPI priority 0
+
+static void *Task_Trampoline(void *arg)
+{
+	struct rtTask *task = arg;
+
+	task->entry(task->arg);
+	return NULL;
+}
+
+/* ***********************************************
+* Run-time
+* ***********************************************/
+
+int RtApi_Main(int (*app)(void *arg), void *arg)
+{
+	if (mlockall(MCL_CURRENT | MCL_FUTURE) != 0)
+		printf("Warning: cannot lock memory [%s]\n", strerror(errno));
+	Time_TscInit();
+
+	return app(arg);
+}
+
+const char *RtApi_Backend(void)
+{
+	return "posix";
+}
+
+int64_t RtApi_Now(void)
+{
+	return Time_Now();
+}
+
+void RtApi_Sleep(int64_t ns)
+{
+	struct timespec ts = Time_NsToTs(ns);
+
+	while (clock_nanosleep(CLOCK_MONOTONIC, 0, &ts, &ts) == EINTR)
+		;
+}
+
+/* ***********************************************
+* Tasks
+* ***********************************************/
+
+int RtTask_Create(struct rtTask *task, const char *name, int priority, int cpu, rtEntry_t entry, void *arg)
+{
+	struct sched_param parm;
+	pthread_attr_t attr;
+	cpu_set_t cpuset;
+	int err;
+
+	if (priority < 1 || priority > RTAPI_PRIO_MAX)
+		return -EINVAL;
+
+	memset(task, 0, sizeof(*task));
+	strncpy(task->name, name, RTAPI_NAME_LEN - 1);
+	task->priority = priority;
+	task->cpu = cpu;
+	task->entry = entry;
+	task->arg = arg;
+	RtStats_Init(&task->stats);
+
+	pthread_attr_init(&attr);
+	pthread_attr_setinheritsched(&attr, PTHREAD_EXPLICIT_SCHED);
+	pthread_attr_setschedpolicy(&attr, SCHED_FIFO);
+	parm.sched_priority = PRIO_BASE + priority;
+	pthread_attr_setschedparam(&attr, &parm);
+	if (cpu >= 0)
+	{
+		CPU_ZERO(&cpuset);
+		CPU_SET(cpu, &cpuset);
+		pthread_attr_setaffinity_np(&attr, sizeof(cpuset), &cpuset);
+	}
+
+	err = pthread_create(&task->thread, &attr, Task_Trampoline, task);
+	pthread_attr_destroy(&attr);
+	if (err == 0)
+		pthread_setname_np(task->thread, task->name);
+
+	return -err;
+}
+
+int RtTask_SetPeriodic(struct rtTask *task, int64_t start_ns, int64_t period_ns)
+{
+	if (period_ns <= 0)
+		return -EINVAL;
+
+	task->period_ns = period_ns;
+	task->next_ns = (start_ns != 0 ? start_ns : Time_Now());
+	return 0;
+}
+
+int RtTask_WaitPeriod(struct rtTask *task)
+{
+	int64_t end = (task->stats.jobs > 0 ? Time_Now() : 0);
+	struct timespec next = Time_NsToTs(task->next_ns);
+	int64_t now;
+	int missed = 0;
+
+	if (task->period_ns == 0)
+		return -EINVAL;
+
+	while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &next, NULL) == EINTR)
+		;
+	now = Time_Now();
+
+	/* Releases that went by while the previous job ran are skipped */
+	if (now - task->next_ns >= task->period_ns)
+		missed = (int)((now - task->next_ns) / task->period_ns);
+	task->next_ns += missed * task->period_ns;
+
+	RtStats_Release(&task->stats, end, task->next_ns, now, missed);
+	task->next_ns += task->period_ns;
+
+	return missed;
+}
+
+int RtTask_Join(struct rtTask *task)
+{
+	return -pthread_join(task->thread, NULL);
+}
+
+/* ***********************************************
+* Semaphores
+* ***********************************************/
+
+int RtSem_Init(struct rtSem *sem, unsigned int count)
+{
+	return sem_init(&sem->sem, 0, count) == 0 ? 0 : -errno;
+}
+
+int RtSem_Wait(struct rtSem *sem)
+{
+	while (sem_wait(&sem->sem) != 0)
+		if (errno != EINTR)
+			return -errno;
+	return 0;
+}
+
+int RtSem_Post(struct rtSem *sem)
+{
+	return sem_post(&sem->sem) == 0 ? 0 : -errno;
+}
+
+void RtSem_Destroy(struct rtSem *sem)
+{
+	sem_destroy(&sem->sem);
+}
+
+/* ***********************************************
+* Mutexes
+* ***********************************************/
+
+int RtMutex_Init(struct rtMutex *mutex, int protocol, int ceiling)
+{
+	static const int native[] = {PTHREAD_PRIO_NONE, PTHREAD_PRIO_INHERIT, PTHREAD_PRIO_PROTECT};
+	pthread_mutexattr_t attr;
+	int err;
+
+	if (protocol < RTMUTEX_NONE || protocol > RTMUTEX_PROTECT)
+		return -EINVAL;
+
+	mutex->protocol = protocol;
+	pthread_mutexattr_init(&attr);
+	err = pthread_mutexattr_setprotocol(&attr, native[protocol]);
+	if (err == 0 && protocol == RTMUTEX_PROTECT)
+		err = pthread_mutexattr_setprioceiling(&attr, PRIO_BASE + ceiling);
+	if (err == 0)
+		err = pthread_mutex_init(&mutex->mutex, &attr);
+	pthread_mutexattr_destroy(&attr);
+
+	return -err;
+}
+
+int RtMutex_Lock(struct rtMutex *mutex)
+{
+	return -pthread_mutex_lock(&mutex->mutex);
+}
+
+int RtMutex_Unlock(struct rtMutex *mutex)
+{
+	return -pthread_mutex_unlock(&mutex->mutex);
+}
+
+void RtMutex_Destroy(struct rtMutex *mutex)
+{
+	pthread_mutex_destroy(&mutex->mutex);
+}
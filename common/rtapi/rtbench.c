@@ -0,0 +1,202 @@
+/******************************************************************
+ * DETI/UA/IT - Real-Time Operating Systems course
+ *
+ * Kernel comparison benchmark on the portable RT task API.
+ *
+ * The same task set, workloads and measurements run unchanged on
+ * every rtapi backend (make BACKEND=posix|alchemy|freertos): the
+ * tasks are created, wait on a start semaphore, become periodic with
+ * a common first release and run a calibrated workload per job.
+ * Task A also publishes its state on a CAB (see cab.h), which the
+ * slower tasks read at each job. At the end the wake-up latency and
+ * execution time statistics of each task are printed, and the age
+ * of the state seen by the readers.
+ *
+ * Usage: rtbench_BACKEND [-d SECONDS] [-c CPU]
+ *
+ *****************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "rtapi.h"
+#include "load.h"
+#include "cab.h"
+
+#define MS_2_NS(ms) ((int64_t)(ms) * 1000 * 1000)
+
+#define START_DELAY_NS MS_2_NS(100) // From the start semaphore to the first release
+
+/* The task set: periods are multiples of 1 ms (the FreeRTOS tick) */
+static const struct
+{
+	const char *name;
+	int priority; // 1..RTAPI_PRIO_MAX
+	int period_ms;
+	int kind;	  // Workload kernel (see load.h)
+	int load_ms;
+} taskSet[] = {
+	{"A", 30, 10, LOAD_FP, 1},
+	{"B", 20, 20, LOAD_CHASE, 3},
+	{"C", 10, 50, LOAD_STREAM, 5},
+};
+
+#define NTASKS ((int)(sizeof(taskSet) / sizeof(taskSet[0])))
+
+/* State shared through the CAB: written by task A, read by the others */
+struct state
+{
+	uint64_t job;
+	int64_t time_ns; // Publication time
+	uint64_t check;	 // ~job: a torn message would not match
+};
+
+#define NREADERS (NTASKS - 1)
+
+struct benchTask
+{
+	struct rtTask task;
+	struct load load;
+	int index;		  // In taskSet[]
+	int64_t maxAge;	  // Oldest state read (ns)
+	uint32_t torn;	  // Inconsistent states read (must stay 0)
+};
+
+static struct benchTask tasks[NTASKS];
+static struct rtSem startSem;
+static struct cab stateCab;
+static char cabMem[(NREADERS + CAB_EXTRA) * CAB_ALIGN] __attribute__((aligned(CAB_ALIGN)));
+static int64_t start_ns;
+static volatile int stop;
+static int duration = 5, cpu = -1;
+
+// Job of task A: publishes its state, without ever blocking
+static void State_Write(uint64_t job)
+{
+	struct state *s = Cab_Reserve(&stateCab);
+
+	s->job = job;
+	s->time_ns = RtApi_Now();
+	s->check = ~job;
+	Cab_Put(&stateCab, s);
+}
+
+// Jobs of the other tasks: read the latest state, without ever blocking
+static void State_Read(struct benchTask *t)
+{
+	const struct state *s = Cab_Get(&stateCab, t->index - 1);
+	int64_t age = RtApi_Now() - s->time_ns;
+
+	if (s->check != ~s->job)
+		t->torn++;
+	if (s->job > 0 && age > t->maxAge)
+		t->maxAge = age;
+	Cab_Unget(&stateCab, t->index - 1);
+}
+
+static void Task_code(void *arg)
+{
+	struct benchTask *t = arg;
+
+	RtSem_Wait(&startSem);
+	if (RtTask_SetPeriodic(&t->task, start_ns, MS_2_NS(taskSet[t->index].period_ms)) != 0)
+	{
+		printf("Task %s: invalid period\n", t->task.name);
+		return;
+	}
+
+	while (!stop)
+	{
+		if (RtTask_WaitPeriod(&t->task) < 0)
+			break;
+		Load_Run(&t->load);
+		if (t->index == 0)
+			State_Write(t->task.stats.jobs);
+		else
+			State_Read(t);
+	}
+}
+
+// The main activity: sets the task set up, lets it run and prints the results
+static int App(void *arg)
+{
+	int i, err;
+	const struct state init = {.job = 0, .time_ns = 0, .check = ~(uint64_t)0};
+
+	(void)arg;
+	printf("rtapi backend: %s, %d tasks, %d s\n", RtApi_Backend(), NTASKS, duration);
+
+	for (i = 0; i < NTASKS; i++)
+	{
+		tasks[i].index = i;
+		if (Load_Init(&tasks[i].load, taskSet[i].kind, MS_2_NS(taskSet[i].load_ms)) != 0)
+		{
+			printf("Task %s: cannot allocate the %s workload\n", taskSet[i].name, Load_Name(taskSet[i].kind));
+			return -1;
+		}
+	}
+
+	if (sizeof(cabMem) < Cab_Size(sizeof(struct state), NREADERS) ||
+		Cab_Init(&stateCab, cabMem, sizeof(struct state), NREADERS, &init) != 0)
+	{
+		printf("Cannot create the state CAB\n");
+		return -1;
+	}
+
+	RtSem_Init(&startSem, 0);
+	for (i = 0; i < NTASKS; i++)
+	{
+		err = RtTask_Create(&tasks[i].task, taskSet[i].name, taskSet[i].priority, cpu, Task_code, &tasks[i]);
+		if (err != 0)
+		{
+			printf("Error creating task %s [%d]\n", taskSet[i].name, err);
+			return -1;
+		}
+	}
+
+	/* Common first release */
+	start_ns = RtApi_Now() + START_DELAY_NS;
+	for (i = 0; i < NTASKS; i++)
+		RtSem_Post(&startSem);
+
+	RtApi_Sleep(MS_2_NS(duration * 1000));
+	stop = 1;
+	for (i = 0; i < NTASKS; i++)
+		RtTask_Join(&tasks[i].task);
+	RtSem_Destroy(&startSem);
+
+	for (i = 0; i < NTASKS; i++)
+	{
+		RtStats_Print(&tasks[i].task);
+		Load_Free(&tasks[i].load);
+	}
+
+	printf("State CAB: %u buffers, %u reads announced by the writer\n", stateCab.nbuffers, stateCab.helped);
+	for (i = 1; i < NTASKS; i++)
+		printf("  %s: oldest state %.3f ms, %u torn\n", tasks[i].task.name, tasks[i].maxAge / 1e6, tasks[i].torn);
+
+	return 0;
+}
+
+int main(int argc, char *argv[])
+{
+	int opt;
+
+	while ((opt = getopt(argc, argv, "d:c:")) != -1)
+	{
+		switch (opt)
+		{
+		case 'd':
+			duration = atoi(optarg);
+			break;
+		case 'c':
+			cpu = atoi(optarg);
+			break;
+		default:
+			printf("Usage: %s [-d SECONDS] [-c CPU]\n", argv[0]);
+			return -1;
+		}
+	}
+
+	return RtApi_Main(App, NULL);
+}
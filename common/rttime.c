@@ -0,0 +1,118 @@
+/******************************************************************
+ * DETI/UA/IT - Real-Time Operating Systems course
+ *
+ * Time library.
+ * See rttime.h
+ *
+ *****************************************************************/
+#include <stdint.h>
+#include <time.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <cpuid.h>
+#endif
+
+#include "rttime.h"
+
+#define PAIR_TRIES 5 // Reads per (TSC, CLOCK_MONOTONIC) pair, the tightest one is kept
+
+struct timeTsc timeTsc;
+
+#if defined(__x86_64__) || defined(__i386__)
+
+/* Invariant TSC (constant rate, runs in deep C-states) and rdtscp */
+static int Tsc_Usable(void)
+{
+	unsigned int eax, ebx, ecx, edx;
+
+	if (!__get_cpuid(0x80000001, &eax, &ebx, &ecx, &edx) || !(edx & (1u << 27)))
+		return 0; // No rdtscp
+	if (!__get_cpuid(0x80000007, &eax, &ebx, &ecx, &edx) || !(edx & (1u << 8)))
+		return 0; // TSC not invariant
+	return 1;
+}
+
+// Reads the TSC and CLOCK_MONOTONIC at (nearly) the same instant
+static void Tsc_Pair(uint64_t *tsc, int64_t *ns)
+{
+	int64_t t1, t2, best = INT64_MAX;
+	uint64_t c;
+	uint32_t lo, hi;
+	int i;
+
+	for (i = 0; i < PAIR_TRIES; i++)
+	{
+		t1 = Time_Now();
+		__asm__ __volatile__("lfence\n\trdtsc" : "=a"(lo), "=d"(hi)::"memory");
+		t2 = Time_Now();
+		c = ((uint64_t)hi << 32) | lo;
+		if (t2 - t1 < best)
+		{
+			best = t2 - t1;
+			*tsc = c;
+			*ns = t1 + (t2 - t1) / 2;
+		}
+	}
+}
+
+int Time_TscInit(void)
+{
+	struct timespec calib = Time_NsToTs(TIME_TSC_CALIB_NS);
+	uint64_t c1, c2;
+	int64_t t1, t2;
+
+	timeTsc.enabled = 0;
+	if (!Tsc_Usable())
+		return 0;
+
+	Tsc_Pair(&c1, &t1);
+	clock_nanosleep(CLOCK_MONOTONIC, 0, &calib, NULL);
+	Tsc_Pair(&c2, &t2);
+	if (c2 <= c1 || t2 <= t1)
+		return 0;
+
+	/* ticks * NS_PER_SEC / ns, in two steps so that it fits in 64 bits */
+	timeTsc.hz = (c2 - c1) / (uint64_t)(t2 - t1) * NS_PER_SEC +
+				 (c2 - c1) % (uint64_t)(t2 - t1) * NS_PER_SEC / (uint64_t)(t2 - t1);
+	timeTsc.mult = ((uint64_t)NS_PER_SEC << TIME_TSC_SHIFT) / timeTsc.hz;
+	timeTsc.enabled = 1;
+
+	/* The TSC must agree with CLOCK_MONOTONIC on a shorter, independent interval */
+	if (Time_TscCheck(TIME_TSC_CALIB_NS / 5) > TIME_TSC_MAX_ERROR_NS)
+		timeTsc.enabled = 0;
+
+	return timeTsc.enabled;
+}
+
+int64_t Time_TscCheck(int64_t interval_ns)
+{
+	struct timespec wait = Time_NsToTs(interval_ns);
+	uint64_t c1, c2;
+	int64_t t1, t2, err;
+
+	if (!timeTsc.enabled)
+		return 0;
+
+	Tsc_Pair(&c1, &t1);
+	clock_nanosleep(CLOCK_MONOTONIC, 0, &wait, NULL);
+	Tsc_Pair(&c2, &t2);
+
+	err = Time_StampNs(c1, c2) - (t2 - t1);
+	return err < 0 ? -err : err;
+}
+
+#else
+
+int Time_TscInit(void)
+{
+	timeTsc.enabled = 0;
+	return 0;
+}
+
+int64_t Time_TscCheck(int64_t interval_ns)
+{
+	(void)interval_ns;
+	return 0;
+}
+
+#endif
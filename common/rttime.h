@@ -0,0 +1,159 @@
+/******************************************************************
+ * DETI/UA/IT - Real-Time Operating Systems course
+ *
+ * Time library: signed 64-bit nanosecond arithmetic and a low
+ * overhead timestamp source.
+ *
+ * All instants and intervals are int64_t nanoseconds (about 292
+ * years of range), so they are added and subtracted with plain
+ * arithmetic and negative results (e.g. lateness) are preserved.
+ * Time_NsToTs()/Time_TsToNs() convert at the system call boundary.
+ *
+ * Absolute instants come from CLOCK_MONOTONIC (Time_Now()). Short
+ * intervals inside the measurement loops are best taken with the
+ * time-stamp counter: Time_StampStart()/Time_StampEnd() read it
+ * (rdtsc after lfence, rdtscp) and Time_StampNs() converts a
+ * difference of stamps to ns. Time_TscInit() enables the TSC path
+ * only on x86 with an invariant TSC, after calibrating its rate
+ * against CLOCK_MONOTONIC and cross-checking the result; otherwise
+ * (or on other architectures) the stamps are CLOCK_MONOTONIC ns.
+ *
+ *****************************************************************/
+#ifndef RTTIME_H
+#define RTTIME_H
+
+#include <stdint.h>
+#include <time.h>
+
+#define NS_PER_SEC 1000000000LL
+
+#define TIME_TSC_CALIB_NS (50 * 1000 * 1000) // Calibration interval
+#define TIME_TSC_MAX_ERROR_NS 1000			 // Cross-check tolerance
+
+/* Conversion of TSC ticks to ns: ns = (ticks * mult) >> TIME_TSC_SHIFT */
+#define TIME_TSC_SHIFT 32
+
+struct timeTsc
+{
+	int enabled;	  // Stamps are TSC ticks
+	uint64_t mult;	  // ns per tick, fixed point
+	uint64_t hz;	  // Calibrated TSC frequency
+};
+
+extern struct timeTsc timeTsc;
+
+/* ***********************************************
+* ns <-> timespec
+* ***********************************************/
+
+static inline int64_t Time_TsToNs(struct timespec ts)
+{
+	return (int64_t)ts.tv_sec * NS_PER_SEC + ts.tv_nsec;
+}
+
+/* tv_nsec is always in [0, 1 s), also for negative values */
+static inline struct timespec Time_NsToTs(int64_t ns)
+{
+	struct timespec ts;
+
+	ts.tv_sec = ns / NS_PER_SEC;
+	ts.tv_nsec = ns % NS_PER_SEC;
+	if (ts.tv_nsec < 0)
+	{
+		ts.tv_sec--;
+		ts.tv_nsec += NS_PER_SEC;
+	}
+	return ts;
+}
+
+/* Current CLOCK_MONOTONIC time */
+static inline int64_t Time_Now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return Time_TsToNs(ts);
+}
+
+/* ***********************************************
+* Timestamps
+* ***********************************************/
+
+#if defined(__x86_64__) || defined(__i386__)
+
+/* Start of an interval: instructions before it complete first */
+static inline uint64_t Time_StampStart(void)
+{
+	uint32_t lo, hi;
+
+	if (!timeTsc.enabled)
+		return (uint64_t)Time_Now();
+	__asm__ __volatile__("lfence\n\trdtsc" : "=a"(lo), "=d"(hi)::"memory");
+	return ((uint64_t)hi << 32) | lo;
+}
+
+/* End of an interval: waits for the measured instructions */
+static inline uint64_t Time_StampEnd(void)
+{
+	uint32_t lo, hi, aux;
+
+	if (!timeTsc.enabled)
+		return (uint64_t)Time_Now();
+	__asm__ __volatile__("rdtscp" : "=a"(lo), "=d"(hi), "=c"(aux)::"memory");
+	return ((uint64_t)hi << 32) | lo;
+}
+
+#else
+
+static inline uint64_t Time_StampStart(void)
+{
+	return (uint64_t)Time_Now();
+}
+
+static inline uint64_t Time_StampEnd(void)
+{
+	return (uint64_t)Time_Now();
+}
+
+#endif
+
+/* (ticks * mult) >> TIME_TSC_SHIFT without overflowing the product */
+static inline uint64_t Time_TscToNs(uint64_t ticks)
+{
+#ifdef __SIZEOF_INT128__
+	return (uint64_t)(((unsigned __int128)ticks * timeTsc.mult) >> TIME_TSC_SHIFT);
+#else
+	/* 32-bit targets: split both factors in 32-bit halves */
+	uint64_t tHi = ticks >> 32, tLo = ticks & 0xFFFFFFFFu;
+	uint64_t mHi = timeTsc.mult >> 32, mLo = timeTsc.mult & 0xFFFFFFFFu;
+
+	return ((tHi * mHi) << 32) + tHi * mLo + tLo * mHi + ((tLo * mLo) >> 32);
+#endif
+}
+
+/* Length of the interval between two stamps, in ns */
+static inline int64_t Time_StampNs(uint64_t start, uint64_t end)
+{
+	int64_t ticks = (int64_t)(end - start);
+
+	if (!timeTsc.enabled)
+		return ticks;
+	if (ticks < 0)
+		return -(int64_t)Time_TscToNs((uint64_t)(-ticks));
+	return (int64_t)Time_TscToNs((uint64_t)ticks);
+}
+
+/*
+ * Enables the TSC stamps if the CPU has an invariant TSC and its
+ * calibrated rate passes the cross-check against CLOCK_MONOTONIC.
+ * Takes about TIME_TSC_CALIB_NS. Returns 1 if enabled, 0 otherwise.
+ */
+int Time_TscInit(void);
+
+/*
+ * Cross-checks the TSC stamps against CLOCK_MONOTONIC over an
+ * interval of "interval_ns". Returns the measured error (ns).
+ */
+int64_t Time_TscCheck(int64_t interval_ns);
+
+#endif
@@ -13,8 +13,10 @@
 /* App includes */
 #include "../UART/uart.h"
 #include "semphr.h"
+#include "timers.h"
 
 #include "TMan.h"
+#include "TManAnalysis.h"
 
 struct Task tasks[NUMBER_OF_TASKS] = {};
 int tasksAdded;
@@ -22,12 +24,868 @@ int maxTasks;
 TickType_t TMan_Tick;
 QueueHandle_t msgs;
 
+/*
+ * estatisticas protegidas por uma sequencia (seqlock):
+ * quem escreve torna statsSeq impar, atualiza e torna-a par outra vez,
+ * quem le repete a copia se a sequencia era impar ou mudou entretanto
+ * o TMan_Ticks e as tasks escrevem, por isso cada atualizacao e feita
+ * numa seccao critica curta (trabalho constante, sem esperas)
+ */
+#define STATS_BEGIN(t) do { taskENTER_CRITICAL(); (t)->statsSeq++; } while (0)
+#define STATS_END(t) do { (t)->statsSeq++; taskEXIT_CRITICAL(); } while (0)
+#define STATS_READ_ATTEMPTS 10
+// as estatisticas nao sao volatile: impede o compilador de mover a copia para fora das leituras da sequencia
+#define STATS_BARRIER() __asm__ volatile("" ::: "memory")
+
+/*
+ * watchdog de deadlines:
+ * cada job libertado entra numa fila ordenada pela deadline absoluta
+ * e um unico timer do FreeRTOS (one-shot) e programado para a deadline
+ * mais proxima; se o job ainda nao terminou quando o timer dispara, o
+ * miss e contado e a missHandler e chamada logo, mesmo que o job nunca
+ * termine (ex: ciclo infinito)
+ * a fila e o timer sao alterados com o escalonador suspenso
+ * requer configUSE_TIMERS = 1 e configTIMER_TASK_PRIORITY acima das
+ * prioridades das tasks (o atraso na detecao e no maximo um tick)
+ */
+static int deadlineQueue[NUMBER_OF_TASKS];     // indices das tasks por ordem de deadline
+static int deadlinesQueued;
+static TimerHandle_t watchdog;
+static TMan_MissHandler missHandler;
+
+/*
+ * orcamentos de execucao:
+ * os hooks de troca de contexto do FreeRTOS somam o tempo de CPU de
+ * cada job (TMAN_CLOCK a entrada e a saida da task) e o tick hook
+ * verifica se a task em execucao excedeu o orcamento; nesse caso a
+ * acao (baixar a prioridade ou suspender) e feita pela task de servico
+ * dos timers, porque nao pode ser feita dentro de uma interrupcao
+ * o orcamento e a prioridade nominal sao repostos na ativacao seguinte
+ */
+static volatile int runningIndex = -1;         // task do TMan em execucao (-1: nenhuma)
+
+/*
+ * trocas de contexto (todas as tasks) e preempcoes de jobs do TMan,
+ * reportadas no fim de cada hiperperiodo
+ */
+static volatile uint32_t contextSwitches;
+static volatile int lastJobOut = -1;           // ultima task do TMan a sair de execucao
+static int hyperperiodEnd;
+
+/*
+ * reservas periodicas:
+ * o tempo de CPU das tasks de uma reserva e somado nos hooks de troca
+ * de contexto; quando esgota o orcamento, o tick hook pede a task de
+ * servico dos timers que suspenda as tasks da reserva, e o TMan_Ticks
+ * repoe o orcamento e retoma os jobs pendentes no inicio de cada periodo
+ * da reserva; ativacoes com a reserva esgotada ficam pendentes ate la
+ */
+static struct Reservation reservations[NUMBER_OF_RESERVATIONS];
+static int reservationsAdded;
+
+#define TMAN_TICK_US ((int64_t) PERIOD * 1000000 / configTICK_RATE_HZ)
+
+/*
+ * mixed criticality:
+ * no modo CRIT_LO um job CRIT_HI que esgota o orcamento CRIT_LO nao e
+ * travado: o sistema passa ao modo CRIT_HI, as tasks CRIT_HI recebem o
+ * orcamento CRIT_HI e os jobs CRIT_LO pendentes sao suspensos (ou
+ * degradados); o regresso ao modo CRIT_LO e feito pelo TMan_Ticks
+ * quando nao ha jobs pendentes
+ */
+static volatile int critMode = CRIT_LO;
+static volatile int modeSwitchPending;
+static int modeSwitches;
+
+// a antes de b, com ticks que dao a volta
+#define TICK_BEFORE(a, b) ((BaseType_t) ((a) - (b)) < 0)
+
+
+/*
+ * funcao por omissao do watchdog: mensagem na fila de impressao
+ */
+static void TMan_DefaultMissHandler(const char* taskName, int job, TickType_t lateness){
+    char mensagem[80];
+    sprintf(mensagem,"Deadline miss: %s, job %d, late %u ticks\n\r", taskName, job, (unsigned) lateness);
+    if( xQueueSend(msgs, mensagem, 0) != pdPASS ) { }
+}
+
+void TMan_TaskSetBudget(int index, int budgetUs, int policy){
+    TMan_TaskSetCriticality(index, CRIT_LO, budgetUs, budgetUs, policy);
+}
+
+void TMan_TaskSetCriticality(int index, int level, int wcetLoUs, int wcetHiUs, int policy){
+    tasks[index].criticality = level;
+    tasks[index].budgetLo = (uint32_t) ((uint64_t) wcetLoUs * TMAN_CLOCK_HZ / 1000000);
+    tasks[index].budgetHi = (level == CRIT_HI) ? (uint32_t) ((uint64_t) wcetHiUs * TMAN_CLOCK_HZ / 1000000) : tasks[index].budgetLo;
+    tasks[index].budget = (critMode == CRIT_HI) ? tasks[index].budgetHi : tasks[index].budgetLo;
+    tasks[index].budgetPolicy = policy;
+}
+
+int TMan_CriticalityMode(void){
+    return critMode;
+}
+
+int TMan_ModeSwitches(void){
+    return modeSwitches;
+}
+
+static void Watchdog_Program(TickType_t now);
+static void Watchdog_Remove(int index);
+static void Reservation_Rank(int r);
+
+/*
+ * muda a prioridade (do FreeRTOS) da task; dentro de uma regiao nao
+ * preemptiva fica guardada e so e aplicada no fim dela
+ */
+static void Task_PrioritySet(int index, UBaseType_t priority){
+    if (tasks[index].npActive) {
+        tasks[index].npSaved = priority;
+    }
+    else if (uxTaskPriorityGet(tasks[index].handle) != priority) {
+        vTaskPrioritySet(tasks[index].handle, priority);
+    }
+}
+
+/*
+ * passagem ao modo CRIT_HI (task de servico dos timers)
+ * index: job CRIT_HI que esgotou o orcamento CRIT_LO
+ */
+static void Mode_SwitchHi(void* param, uint32_t index){
+    char mensagem[80];
+    int i;
+    (void) param;
+    taskENTER_CRITICAL();
+    critMode = CRIT_HI;
+    modeSwitchPending = 0;
+    modeSwitches++;
+    for(i = 0; i < tasksAdded; i++) {
+        tasks[i].budget = tasks[i].budgetHi;
+    }
+    taskEXIT_CRITICAL();
+    for(i = 0; i < tasksAdded; i++) {
+        if (tasks[i].criticality == CRIT_LO && tasks[i].state == RUNNING) {
+            if (MC_LO_IN_HI_MODE == MC_DROP) {
+                vTaskSuspend(tasks[i].handle);  // job abandonado ate a proxima ativacao
+                tasks[i].state = BLOCKED;
+                tasks[i].jobDropped = 1;
+                STATS_BEGIN(&tasks[i]);
+                tasks[i].droppedJobs++;
+                STATS_END(&tasks[i]);
+                // a deadline dele deixa de contar para o watchdog
+                vTaskSuspendAll();
+                Watchdog_Remove(i);
+                Watchdog_Program(xTaskGetTickCount());
+                xTaskResumeAll();
+            }
+            else {
+                Task_PrioritySet(i, tskIDLE_PRIORITY);
+            }
+        }
+    }
+    sprintf(mensagem,"Mode HI: %s, job %d\n\r", tasks[index].name, tasks[index].numberOfActivation);
+    if( xQueueSend(msgs, mensagem, 0) != pdPASS ) { }
+}
+
+/*
+ * regresso ao modo CRIT_LO num instante sem jobs pendentes (TMan_Ticks)
+ */
+static void Mode_SwitchLo(void){
+    int i;
+    if (critMode == CRIT_LO || modeSwitchPending) {
+        return;
+    }
+    for(i = 0; i < tasksAdded; i++) {
+        if (tasks[i].state == RUNNING) {
+            return;
+        }
+    }
+    taskENTER_CRITICAL();
+    critMode = CRIT_LO;
+    for(i = 0; i < tasksAdded; i++) {
+        tasks[i].budget = tasks[i].budgetLo;
+    }
+    taskEXIT_CRITICAL();
+    // tasks CRIT_LO degradadas voltam ja a prioridade nominal (ou a da banda da reserva)
+    for(i = 0; i < tasksAdded; i++) {
+        if (tasks[i].criticality == CRIT_LO) {
+            Task_PrioritySet(i, TMAN_LEVEL(tasks[i].priority));
+        }
+    }
+    for(i = 0; i < reservationsAdded; i++) {
+        Reservation_Rank(i);
+    }
+    if( xQueueSend(msgs, "Mode LO\n\r", 0) != pdPASS ) { }
+}
+
+/*
+ * task CRIT_LO nao ativada no modo CRIT_HI
+ */
+static int Mode_Drops(int index){
+    return critMode == CRIT_HI && tasks[index].criticality == CRIT_LO && MC_LO_IN_HI_MODE == MC_DROP;
+}
+
+void TMan_TaskSwitchedIn(void){
+    TaskHandle_t handle = xTaskGetCurrentTaskHandle();
+    int i;
+    contextSwitches++;
+    runningIndex = -1;
+    for(i = 0; i < tasksAdded; i++) {
+        if (tasks[i].handle == handle) {
+            tasks[i].switchedIn = TMAN_CLOCK();
+            runningIndex = i;
+            // outro job do TMan comecou com o anterior por terminar: preempcao
+            if (lastJobOut >= 0 && lastJobOut != i && tasks[lastJobOut].state == RUNNING && tasks[i].state == RUNNING) {
+                tasks[lastJobOut].preemptions++;
+            }
+            lastJobOut = -1;
+            break;
+        }
+    }
+}
+
+void TMan_TaskSwitchedOut(void){
+    int i = runningIndex;
+    uint32_t exec;
+    if (i >= 0) {
+        exec = TMAN_CLOCK() - tasks[i].switchedIn;
+        tasks[i].jobExec += exec;
+        lastJobOut = i;
+        if (tasks[i].reservation >= 0) {
+            reservations[tasks[i].reservation].consumed += exec;
+        }
+    }
+}
+
+/*
+ * reserva esgotada: suspende as suas tasks (task de servico dos timers)
+ */
+static void Reservation_Deplete(void* param, uint32_t r){
+    int i;
+    (void) param;
+    for(i = 0; i < tasksAdded; i++) {
+        if (tasks[i].reservation == (int) r) {
+            vTaskSuspend(tasks[i].handle);
+        }
+    }
+}
+
+/*
+ * verifica o orcamento da reserva da task em execucao (tick hook)
+ */
+static void Reservation_Check(int i){
+    struct Reservation* res;
+    if (tasks[i].reservation < 0) {
+        return;
+    }
+    res = &reservations[tasks[i].reservation];
+    if (!res->depleted && res->consumed + (TMAN_CLOCK() - tasks[i].switchedIn) > res->budget) {
+        res->depleted = 1;
+        res->depletions++;
+        xTimerPendFunctionCallFromISR(Reservation_Deplete, NULL, (uint32_t) tasks[i].reservation, NULL);
+    }
+}
+
+/*
+ * repoe os orcamentos das reservas cujo periodo comeca (TMan_Ticks)
+ */
+static void Reservations_Replenish(void){
+    int r, i;
+    for(r = 0; r < reservationsAdded; r++) {
+        if ((int) TMan_Tick < reservations[r].nextReplenish) {
+            continue;
+        }
+        reservations[r].nextReplenish += reservations[r].period;
+        taskENTER_CRITICAL();
+        reservations[r].consumed = 0;
+        if (reservations[r].depleted) {
+            reservations[r].depleted = 0;
+            taskEXIT_CRITICAL();
+            // retoma os jobs pendentes (nao os que esperam pela ativacao ou foram travados)
+            for(i = 0; i < tasksAdded; i++) {
+                if (tasks[i].reservation == r && tasks[i].state == RUNNING
+                        && !(tasks[i].throttled && tasks[i].budgetPolicy == BUDGET_SUSPEND)) {
+                    vTaskResume(tasks[i].handle);
+                }
+            }
+        }
+        else {
+            taskEXIT_CRITICAL();
+        }
+    }
+}
+
+/*
+ * prioridades das tasks da reserva na sua banda priority .. priority + n - 1
+ * EDF: jobs pendentes por ordem de deadline absoluta (a mais proxima com
+ * a prioridade maior); FP: pela ordem das prioridades das tasks
+ */
+static void Reservation_Rank(int r){
+    int i, k, later;
+    if (r < 0) {
+        return;
+    }
+    for(i = 0; i < tasksAdded; i++) {
+        if (tasks[i].reservation != r || (reservations[r].policy == RES_EDF && tasks[i].state != RUNNING)) {
+            continue;
+        }
+        later = 0;
+        for(k = 0; k < tasksAdded; k++) {
+            if (k == i || tasks[k].reservation != r) {
+                continue;
+            }
+            if (reservations[r].policy == RES_EDF) {
+                if (tasks[k].state == RUNNING && TICK_BEFORE(tasks[i].absDeadline, tasks[k].absDeadline)) {
+                    later++;
+                }
+            }
+            else if (tasks[k].priority < tasks[i].priority) {
+                later++;
+            }
+        }
+        if (!tasks[i].throttled && !(critMode == CRIT_HI && tasks[i].criticality == CRIT_LO)) {
+            Task_PrioritySet(i, TMAN_LEVEL(reservations[r].priority + later));
+        }
+    }
+}
+
+/*
+ * ativa o job da task, exceto se a reserva esta esgotada (fica pendente)
+ */
+static void Reservation_Resume(int index){
+    if (tasks[index].reservation >= 0 && reservations[tasks[index].reservation].depleted) {
+        return;
+    }
+    vTaskResume(tasks[index].handle);
+}
+
+int TMan_ReservationAdd(const char* name, int budgetUs, int period, int policy, UBaseType_t priority){
+    struct Reservation* res;
+    if (reservationsAdded == NUMBER_OF_RESERVATIONS || period <= 0) {
+        printf("Could not add reservation %s!\n", name);
+        return -1;
+    }
+    res = &reservations[reservationsAdded];
+    res->name = name;
+    res->period = period;
+    res->budgetUs = budgetUs;
+    res->budget = (uint32_t) ((uint64_t) budgetUs * TMAN_CLOCK_HZ / 1000000);
+    res->policy = policy;
+    res->priority = priority;
+    res->consumed = 0;
+    res->nextReplenish = 0;
+    res->depleted = 0;
+    res->depletions = 0;
+    return reservationsAdded++;
+}
+
+void TMan_TaskSetReservation(int index, int reservation){
+    tasks[index].reservation = reservation;
+}
+
+/*
+ * parametros de analise da task: WCET = orcamento CRIT_LO, esporadicas
+ * com o periodo da task de que dependem
+ * retorna -1 (e imprime) se a task nao tem orcamento, porque sem WCET a
+ * analise passaria sempre
+ */
+static int Task_MinInterarrival(int index){
+    int k, period = tasks[index].period;
+    if (period <= 0) {
+        period = tasks[index].deadline;
+        for(k = 0; k < tasksAdded; k++) {
+            if (tasks[k].name == tasks[index].precedence && tasks[k].period > 0) {
+                period = tasks[k].period;
+            }
+        }
+    }
+    return period;
+}
+
+static int Task_Analysis(int index, struct AnalysisTask* t){
+    if (tasks[index].budgetLo == 0) {
+        printf("Task %s has no budget (WCET)!\n", tasks[index].name);
+        return -1;
+    }
+    t->wcet = (int64_t) tasks[index].budgetLo * 1000000 / TMAN_CLOCK_HZ;
+    t->period = Task_MinInterarrival(index) * TMAN_TICK_US;
+    t->deadline = tasks[index].deadline * TMAN_TICK_US;
+    t->priority = (int) tasks[index].priority;
+    t->threshold = (int) tasks[index].threshold;
+    t->npRegion = tasks[index].npRegionUs;
+    t->jitter = 0;
+    return 0;
+}
+
+void TMan_TaskSetPreemption(int index, UBaseType_t threshold, int npRegionUs){
+    tasks[index].threshold = (threshold > tasks[index].priority) ? threshold : tasks[index].priority;
+    tasks[index].npRegionUs = npRegionUs;
+}
+
+void TMan_NonPreemptiveBegin(void){
+    int i;
+    for(i = 0; i < tasksAdded; i++) {
+        if (tasks[i].handle == xTaskGetCurrentTaskHandle()) {
+            vTaskSuspendAll();
+            tasks[i].npSaved = uxTaskPriorityGet(NULL);
+            tasks[i].npActive = 1;
+            vTaskPrioritySet(NULL, NP_PRIORITY);
+            xTaskResumeAll();
+        }
+    }
+}
+
+void TMan_NonPreemptiveEnd(void){
+    int i;
+    for(i = 0; i < tasksAdded; i++) {
+        if (tasks[i].handle == xTaskGetCurrentTaskHandle()) {
+            // repoe a prioridade guardada ou a que foi pedida entretanto (degradacao, EDF, orcamento)
+            vTaskSuspendAll();
+            tasks[i].npActive = 0;
+            vTaskPrioritySet(NULL, tasks[i].npSaved);
+            xTaskResumeAll();                           // preempcao diferida acontece aqui
+        }
+    }
+}
+
+int TMan_ResponseTimeAnalyse(void){
+    struct AnalysisTask set[NUMBER_OF_TASKS];
+    int64_t r;
+    int i, result = 0;
+    for(i = 0; i < tasksAdded; i++) {
+        if (Task_Analysis(i, &set[i]) != 0) {
+            return -1;
+        }
+    }
+    for(i = 0; i < tasksAdded; i++) {
+        r = Analysis_PtResponseTime(set, tasksAdded, i);
+        if (r < 0) {
+            printf("Task %s: not schedulable\n", tasks[i].name);
+            result = -1;
+        }
+        else {
+            printf("Task %s: worst-case response time %ld us (%ld us without thresholds)\n", tasks[i].name, (long) r,
+                   (long) Analysis_FpResponseTime(set, tasksAdded, i));
+        }
+    }
+    return result;
+}
+
+/*
+ * fim de um hiperperiodo: reporta as trocas de contexto e preempcoes
+ * nele e calcula o fim do seguinte com os periodos atuais (TMan_Ticks)
+ */
+static void Hyperperiod_Report(void){
+    char mensagem[80];
+    static uint32_t lastSwitches;
+    static int lastPreemptions;
+    uint32_t switches = contextSwitches;
+    int i, preemptions = 0, a, b, t, length = 1, periodic = 0;
+    if ((int) TMan_Tick < hyperperiodEnd) {
+        return;
+    }
+    for(i = 0; i < tasksAdded; i++) {
+        preemptions += tasks[i].preemptions;
+        if (tasks[i].period > 0) {
+            // mmc dos periodos
+            periodic = 1;
+            a = length;
+            b = tasks[i].period;
+            while (b != 0) {
+                t = a % b;
+                a = b;
+                b = t;
+            }
+            length = length / a * tasks[i].period;
+        }
+    }
+    if (!periodic) {
+        return;     // sem tasks periodicas nao ha hiperperiodo
+    }
+    if (TMan_Tick > 0) {
+        sprintf(mensagem,"Hyperperiod: %u context switches, %d preemptions\n\r", (unsigned) (switches - lastSwitches),
+                preemptions - lastPreemptions);
+        if( xQueueSend(msgs, mensagem, 0) != pdPASS ) { }
+    }
+    lastSwitches = switches;
+    lastPreemptions = preemptions;
+    hyperperiodEnd = (int) TMan_Tick + length;
+}
+
+int TMan_ReservationAnalyse(int reservation){
+    struct Reservation* res = &reservations[reservation];
+    struct AnalysisTask set[NUMBER_OF_TASKS];
+    int map[NUMBER_OF_TASKS];
+    int i, n = 0, fail;
+    for(i = 0; i < tasksAdded; i++) {
+        if (tasks[i].reservation == reservation) {
+            if (Task_Analysis(i, &set[n]) != 0) {
+                return -1;
+            }
+            map[n++] = i;
+        }
+    }
+    if (res->policy == RES_EDF) {
+        fail = Analysis_EdfSupply(set, n, res->budgetUs, res->period * TMAN_TICK_US);
+    }
+    else {
+        fail = Analysis_FpSupply(set, n, res->budgetUs, res->period * TMAN_TICK_US);
+    }
+    if (fail >= 0) {
+        printf("Reservation %s (%d us / %d ticks, %s): task %s not schedulable\n", res->name, res->budgetUs,
+               res->period, res->policy == RES_EDF ? "EDF" : "FP", tasks[map[fail]].name);
+        return -1;
+    }
+    printf("Reservation %s (%d us / %d ticks, %s): %d tasks schedulable\n", res->name, res->budgetUs, res->period,
+           res->policy == RES_EDF ? "EDF" : "FP", n);
+    return 0;
+}
+
+/*
+ * ultima prioridade da banda da reserva (priority + n - 1, n tasks)
+ */
+static int Reservation_BandTop(int r){
+    int i, n = 0;
+    for(i = 0; i < tasksAdded; i++) {
+        if (tasks[i].reservation == r) {
+            n++;
+        }
+    }
+    return (int) reservations[r].priority + (n > 0 ? n - 1 : 0);
+}
+
+int TMan_ReservationsAnalyse(void){
+    struct AnalysisTask servers[NUMBER_OF_RESERVATIONS];
+    int r, k, result = 0;
+    // cada reserva isoladamente
+    for(r = 0; r < reservationsAdded; r++) {
+        if (TMan_ReservationAnalyse(r) != 0) {
+            result = -1;
+        }
+        servers[r].wcet = reservations[r].budgetUs;
+        servers[r].period = reservations[r].period * TMAN_TICK_US;
+        servers[r].deadline = servers[r].period;
+        servers[r].priority = (int) reservations[r].priority;
+        servers[r].jitter = servers[r].period - servers[r].wcet;   // o orcamento guardado pode correr no fim do periodo
+    }
+    // as bandas de prioridades nao se podem intercalar, senao as reservas nao sao servidores de prioridade fixa
+    for(r = 0; r < reservationsAdded; r++) {
+        for(k = r + 1; k < reservationsAdded; k++) {
+            if (servers[r].priority <= Reservation_BandTop(k) && servers[k].priority <= Reservation_BandTop(r)) {
+                printf("Reservations %s and %s: priority bands overlap\n", reservations[r].name, reservations[k].name);
+                result = -1;
+            }
+        }
+    }
+    // as reservas entre si: servidores diferiveis (budget, period) com prioridades fixas
+    for(r = 0; r < reservationsAdded; r++) {
+        if (Analysis_FpResponseTime(servers, reservationsAdded, r) < 0) {
+            printf("Reservation %s: budget not guaranteed every period\n", reservations[r].name);
+            result = -1;
+        }
+    }
+    return result;
+}
+
+/*
+ * tasks elasticas (modelo elastico de Buttazzo):
+ * em cada TMan Tick a utilizacao e estimada com os tempos de execucao
+ * medidos; se excede ELASTIC_U_DESIRED, as utilizacoes das tasks
+ * elasticas sao comprimidas em proporcao a elasticidade, sem descer
+ * abaixo de C / maxPeriod (as que chegam a esse limite ficam fixas e o
+ * calculo repete-se), e os novos periodos so se aplicam na ativacao
+ * seguinte de cada task
+ */
+static int elasticTasks;                        // tasks com elasticidade > 0
+static int interarrival[NUMBER_OF_TASKS];       // Task_MinInterarrival das tasks, calculado uma vez
+static int interarrivalTasks;                   // tasks com interarrival calculado
+
+static void Elastic_Update(void){
+    int64_t c[NUMBER_OF_TASKS], u0[NUMBER_OF_TASKS], umin[NUMBER_OF_TASKS], u[NUMBER_OF_TASKS];
+    int fixed[NUMBER_OF_TASKS];
+    int64_t total = 0, uf, uv0, ev;
+    int i, again, period;
+
+    if (elasticTasks == 0) {
+        return;
+    }
+    if (interarrivalTasks != tasksAdded) {
+        for(i = 0; i < tasksAdded; i++) {
+            interarrival[i] = Task_MinInterarrival(i);
+        }
+        interarrivalTasks = tasksAdded;
+    }
+
+    for(i = 0; i < tasksAdded; i++) {
+        c[i] = (int64_t) tasks[i].execAvg * 1000000 / TMAN_CLOCK_HZ;   // us
+        if (tasks[i].elasticity > 0) {
+            u0[i] = c[i] * 1000000 / (tasks[i].nominalPeriod * TMAN_TICK_US);
+            umin[i] = c[i] * 1000000 / (tasks[i].maxPeriod * TMAN_TICK_US);
+        }
+        else if (interarrival[i] > 0) {
+            u0[i] = umin[i] = c[i] * 1000000 / (interarrival[i] * TMAN_TICK_US);
+        }
+        else {
+            u0[i] = umin[i] = 0;
+        }
+        u[i] = u0[i];
+        fixed[i] = (tasks[i].elasticity <= 0);
+        total += u0[i];
+    }
+
+    if (total > ELASTIC_U_DESIRED) {
+        do {
+            again = 0;
+            uf = uv0 = ev = 0;
+            for(i = 0; i < tasksAdded; i++) {
+                if (fixed[i]) {
+                    uf += u[i];
+                }
+                else {
+                    uv0 += u0[i];
+                    ev += tasks[i].elasticity;
+                }
+            }
+            if (ev == 0) {
+                break;      // nada mais a comprimir: sobrecarga inevitavel
+            }
+            for(i = 0; i < tasksAdded; i++) {
+                if (!fixed[i]) {
+                    u[i] = u0[i] - (uv0 - ELASTIC_U_DESIRED + uf) * tasks[i].elasticity / ev;
+                    if (u[i] < umin[i]) {
+                        u[i] = umin[i];
+                        fixed[i] = 1;
+                        again = 1;
+                    }
+                }
+            }
+        } while (again);
+    }
+
+    for(i = 0; i < tasksAdded; i++) {
+        if (tasks[i].elasticity <= 0) {
+            continue;
+        }
+        period = tasks[i].nominalPeriod;
+        if (u[i] > 0 && u[i] < u0[i]) {
+            period = (int) ((c[i] * 1000000 + u[i] * TMAN_TICK_US - 1) / (u[i] * TMAN_TICK_US));
+        }
+        if (period < tasks[i].nominalPeriod) {
+            period = tasks[i].nominalPeriod;
+        }
+        if (period > tasks[i].maxPeriod) {
+            period = tasks[i].maxPeriod;
+        }
+        tasks[i].newPeriod = period;
+    }
+}
+
+/*
+ * aplica o novo periodo da task (so numa ativacao)
+ */
+static void Elastic_Apply(int index){
+    char mensagem[80];
+    if (tasks[index].elasticity > 0 && tasks[index].newPeriod != tasks[index].period) {
+        sprintf(mensagem,"Elastic: %s, period %d -> %d\n\r", tasks[index].name, tasks[index].period, tasks[index].newPeriod);
+        if( xQueueSend(msgs, mensagem, 0) != pdPASS ) { }
+        tasks[index].period = tasks[index].newPeriod;
+    }
+}
+
+void TMan_TaskSetElastic(int index, int maxPeriod, int elasticity){
+    if (tasks[index].nominalPeriod <= 0) {
+        printf("Task %s is not periodic!\n", tasks[index].name);
+        return;
+    }
+    tasks[index].maxPeriod = (maxPeriod > tasks[index].nominalPeriod) ? maxPeriod : tasks[index].nominalPeriod;
+    elasticTasks += (elasticity > 0) - (tasks[index].elasticity > 0);
+    tasks[index].elasticity = elasticity;
+    tasks[index].newPeriod = tasks[index].period;
+}
+
+/*
+ * acao sobre um job que excedeu o orcamento (task de servico dos timers)
+ */
+static void Budget_Enforce(void* param, uint32_t index){
+    char mensagem[80];
+    (void) param;
+    if (tasks[index].budgetPolicy == BUDGET_SUSPEND) {
+        vTaskSuspend(tasks[index].handle);
+    }
+    else {
+        Task_PrioritySet((int) index, tskIDLE_PRIORITY);
+    }
+    sprintf(mensagem,"Budget overrun: %s, job %d\n\r", tasks[index].name, tasks[index].numberOfActivation);
+    if( xQueueSend(msgs, mensagem, 0) != pdPASS ) { }
+}
+
+void TMan_TickHook(void){
+    int i = runningIndex;
+    if (i >= 0) {
+        Reservation_Check(i);
+    }
+    if (i < 0 || tasks[i].budget == 0 || tasks[i].throttled) {
+        return;
+    }
+    if (tasks[i].jobExec + (TMAN_CLOCK() - tasks[i].switchedIn) > tasks[i].budget) {
+        if (tasks[i].criticality == CRIT_HI && critMode == CRIT_LO) {
+            // nao e um overrun: o job continua com o orcamento CRIT_HI
+            tasks[i].budget = tasks[i].budgetHi;
+            if (!modeSwitchPending) {
+                modeSwitchPending = 1;
+                xTimerPendFunctionCallFromISR(Mode_SwitchHi, NULL, (uint32_t) i, NULL);
+            }
+            return;
+        }
+        tasks[i].throttled = 1;
+        tasks[i].budgetOverruns++;
+        xTimerPendFunctionCallFromISR(Budget_Enforce, NULL, (uint32_t) i, NULL);
+    }
+}
+
+/*
+ * novo job: repoe o orcamento e a prioridade nominal
+ * um job suspenso por BUDGET_SUSPEND ou abandonado por MC_DROP e
+ * retomado para acabar o que faltava; o TMan_TaskWaitPeriod no fim
+ * dele comeca logo o job novo
+ */
+static void Budget_Release(int index){
+    UBaseType_t priority = TMAN_LEVEL(tasks[index].priority);
+    if (tasks[index].throttled && tasks[index].budgetPolicy == BUDGET_SUSPEND) {
+        if (tasks[index].releasePending) {
+            STATS_BEGIN(&tasks[index]);
+            tasks[index].droppedJobs++;     // o job anterior ainda nao acabou: ativacao perdida
+            STATS_END(&tasks[index]);
+        }
+        tasks[index].releasePending = 1;
+    }
+    else if (tasks[index].jobDropped) {
+        tasks[index].releasePending = 1;    // ja contado em droppedJobs
+    }
+    tasks[index].jobDropped = 0;
+    tasks[index].jobExec = 0;
+    tasks[index].throttled = 0;
+    if (critMode == CRIT_HI && tasks[index].criticality == CRIT_LO) {
+        priority = tskIDLE_PRIORITY;    // MC_DEGRADE
+    }
+    Task_PrioritySet(index, priority);
+}
+
+void TMan_SetMissHandler(TMan_MissHandler handler){
+    missHandler = (handler != NULL) ? handler : TMan_DefaultMissHandler;
+}
+
+/*
+ * programa o timer para a deadline mais proxima (chamar com o escalonador suspenso)
+ */
+static void Watchdog_Program(TickType_t now){
+    TickType_t delay;
+    if (deadlinesQueued == 0) {
+        xTimerStop(watchdog, 0);
+        return;
+    }
+    delay = tasks[deadlineQueue[0]].absDeadline - now;
+    if (TICK_BEFORE(tasks[deadlineQueue[0]].absDeadline, now) || delay == 0) {
+        delay = 1;  // ja passou: dispara no proximo tick
+    }
+    xTimerChangePeriod(watchdog, delay, 0);
+}
+
+/*
+ * retira a task da fila de deadlines (chamar com o escalonador suspenso)
+ */
+static void Watchdog_Remove(int index){
+    int i, j;
+    if (!tasks[index].watchdogArmed) {
+        return;
+    }
+    for(i = 0; i < deadlinesQueued; i++) {
+        if (deadlineQueue[i] == index) {
+            for(j = i; j < deadlinesQueued - 1; j++) {
+                deadlineQueue[j] = deadlineQueue[j + 1];
+            }
+            deadlinesQueued--;
+            break;
+        }
+    }
+    tasks[index].watchdogArmed = 0;
+}
+
+/*
+ * novo job da task: deadline absoluta = ativacao + deadline relativa
+ */
+static void Watchdog_Arm(int index, TickType_t release){
+    int i;
+    vTaskSuspendAll();
+    Watchdog_Remove(index);     // job anterior por terminar: passa a valer a nova deadline
+    tasks[index].absDeadline = release + (TickType_t) tasks[index].deadline * PERIOD;
+    i = deadlinesQueued;
+    while (i > 0 && TICK_BEFORE(tasks[index].absDeadline, tasks[deadlineQueue[i - 1]].absDeadline)) {
+        deadlineQueue[i] = deadlineQueue[i - 1];
+        i--;
+    }
+    deadlineQueue[i] = index;
+    deadlinesQueued++;
+    tasks[index].watchdogArmed = 1;
+    if (i == 0) {
+        Watchdog_Program(release);
+    }
+    xTaskResumeAll();
+}
+
+/*
+ * job terminou: retira a deadline; retorna 1 se o watchdog ja contou o miss
+ */
+static int Watchdog_Disarm(int index){
+    int first, missed;
+    vTaskSuspendAll();
+    first = (deadlinesQueued > 0 && deadlineQueue[0] == index);
+    Watchdog_Remove(index);
+    if (first) {
+        Watchdog_Program(xTaskGetTickCount());
+    }
+    missed = tasks[index].jobMissed;
+    tasks[index].jobMissed = 0;
+    xTaskResumeAll();
+    return missed;
+}
+
+/*
+ * callback do timer: todas as deadlines ja passadas sao misses
+ */
+static void Watchdog_Expired(TimerHandle_t timer){
+    TickType_t now = xTaskGetTickCount();
+    int index;
+    (void) timer;
+    for(;;) {
+        vTaskSuspendAll();
+        if (deadlinesQueued == 0 || TICK_BEFORE(now, tasks[deadlineQueue[0]].absDeadline)) {
+            Watchdog_Program(now);
+            xTaskResumeAll();
+            break;
+        }
+        index = deadlineQueue[0];
+        Watchdog_Remove(index);
+        tasks[index].jobMissed = 1;
+        STATS_BEGIN(&tasks[index]);
+        tasks[index].deadlineMissedCounter++;
+        STATS_END(&tasks[index]);
+        xTaskResumeAll();
+
+        missHandler(tasks[index].name, tasks[index].numberOfActivation, now - tasks[index].absDeadline);
+    }
+}
 
 void TMan_Init(int nMax){    
     tasksAdded = 0;
     maxTasks = nMax;
     msgs = xQueueCreate(maxTasks * 5,sizeof(char)*80);
     
+    deadlinesQueued = 0;
+    reservationsAdded = 0;
+    missHandler = TMan_DefaultMissHandler;
+    watchdog = xTimerCreate("watchdog", 1, pdFALSE, NULL, Watchdog_Expired);
+    
     xTaskCreate(TMan_Ticks, (const signed char * const ) "ticks", configMINIMAL_STACK_SIZE, NULL, PRIORITY_TICKS, NULL);
     
     xTaskCreate(TMan_Print, ( const signed char * const ) "prints", configMINIMAL_STACK_SIZE, NULL, PRINTS_PRIORITY, NULL );
@@ -47,6 +905,7 @@ void TMan_Close(void) {
     }
     
     tasksAdded = 0;
+    xTimerDelete(watchdog, 0);
     
     TaskHandle_t handle = xTaskGetHandle("ticks");
     vTaskDelete(handle);
@@ -61,25 +920,40 @@ void TMan_Ticks(void *pvParams) {
     
     for(;;){
         int i;
+        Mode_SwitchLo();
+        Reservations_Replenish();
+        Elastic_Update();
+        Hyperperiod_Report();
         for(i = 0; i < tasksAdded; i++){
-            
-            TaskHandle_t handle = xTaskGetHandle(tasks[i].name);
-            
             if (strcmp(tasks[i].precedence, "x") == 0) {    // nao tem precedencia
                 if( (int) TMan_Tick >= tasks[i].nextActivation) { 
-                    if ( (int) TMan_Tick <= tasks[i].nextActivation + tasks[i].deadline) { 
-                        TaskHandle_t handle = xTaskGetHandle(tasks[i].name);
+                    if (Mode_Drops(i)) {
+                        STATS_BEGIN(&tasks[i]);
+                        tasks[i].droppedJobs++;
+                        tasks[i].currentActivation = tasks[i].nextActivation;
+                        tasks[i].nextActivation += tasks[i].period;
+                        STATS_END(&tasks[i]);
+                    }
+                    else if ( (int) TMan_Tick <= tasks[i].nextActivation + tasks[i].deadline) { 
+                        Elastic_Apply(i);
+                        STATS_BEGIN(&tasks[i]);
                         tasks[i].currentActivation = tasks[i].nextActivation;
                         tasks[i].nextActivation += tasks[i].period; 
                         tasks[i].numberOfActivation++;
+                        STATS_END(&tasks[i]);
                         tasks[i].state = RUNNING;
-                        vTaskResume(handle);
+                        Watchdog_Arm(i, xTaskGetTickCount());
+                        Budget_Release(i);
+                        Reservation_Rank(tasks[i].reservation);
+                        Reservation_Resume(i);
 
                     }                
                     else{
+                        STATS_BEGIN(&tasks[i]);
                         tasks[i].deadlineMissedCounter++;
                         tasks[i].currentActivation = tasks[i].nextActivation + tasks[i].period;
                         tasks[i].nextActivation += tasks[i].period;
+                        STATS_END(&tasks[i]);
                     }
                 }
             }
@@ -93,11 +967,22 @@ void TMan_Ticks(void *pvParams) {
                     }
                 }
                 
-                if((tasks[indexPre].state == BLOCKED) && (tasks[indexPre].end >= tasks[i].currentActivation)) {
+                if((tasks[indexPre].state == BLOCKED) && (tasks[indexPre].end >= tasks[i].currentActivation) && Mode_Drops(i)) {
+                    STATS_BEGIN(&tasks[i]);
+                    tasks[i].droppedJobs++;
+                    tasks[i].currentActivation = TMan_Tick;
+                    STATS_END(&tasks[i]);
+                }
+                else if((tasks[indexPre].state == BLOCKED) && (tasks[indexPre].end >= tasks[i].currentActivation)) {
+                    STATS_BEGIN(&tasks[i]);
                     tasks[i].currentActivation = TMan_Tick;
                     tasks[i].numberOfActivation++;
+                    STATS_END(&tasks[i]);
                     tasks[i].state = RUNNING;
-                    vTaskResume(handle);
+                    Watchdog_Arm(i, xTaskGetTickCount());
+                    Budget_Release(i);
+                    Reservation_Rank(tasks[i].reservation);
+                    Reservation_Resume(i);
                 }
             }
         }        
@@ -111,17 +996,48 @@ void TMan_TaskWaitPeriod(void){
     
     const char* name = pcTaskGetName(handle);
     // check deadline
-    int i;
+    int i, self = -1, pending = 0;
     for(i = 0; i < tasksAdded; i++) {
         if( strcmp(tasks[i].name, name) == 0) {
+            self = i;
+            // o job travado acabou e o seguinte ja foi ativado: comeca ja, com o orcamento inteiro
+            if (tasks[i].releasePending) {
+                taskENTER_CRITICAL();
+                tasks[i].releasePending = 0;
+                tasks[i].jobExec = 0;
+                tasks[i].switchedIn = TMAN_CLOCK();
+                taskEXIT_CRITICAL();
+                tasks[i].state = RUNNING;
+                pending = 1;
+                break;
+            }
+            // tempo de execucao medio (media exponencial com peso 1/8)
+            if (tasks[i].numberOfActivation > 0) {
+                uint32_t exec = tasks[i].jobExec + (TMAN_CLOCK() - tasks[i].switchedIn);
+                tasks[i].execAvg = (tasks[i].execAvg == 0) ? exec : tasks[i].execAvg - tasks[i].execAvg / 8 + exec / 8;
+            }
+            // miss ja contado pelo watchdog?
+            if (Watchdog_Disarm(i)) {
+                continue;
+            }
             if (tasks[i].currentActivation + tasks[i].deadline < TMan_Tick){
+                STATS_BEGIN(&tasks[i]);
                 tasks[i].deadlineMissedCounter++;
+                STATS_END(&tasks[i]);
             }
         }
     }
     
     // suspend
-    vTaskSuspend(NULL);
+    if (!pending) {
+        vTaskSuspend(NULL);
+    }
+    
+    // o job comecou: passa ao limiar de preempcao (a ativacao repos a prioridade nominal)
+    if (self >= 0 && tasks[self].reservation < 0 && tasks[self].threshold > tasks[self].priority
+            && uxTaskPriorityGet(NULL) == TMAN_LEVEL(tasks[self].priority)) {
+        vTaskPrioritySet(NULL, TMAN_THRESHOLD_LEVEL(tasks[self].threshold));
+    }
 }
 
 int TMan_TaskAdd(const char* taskName){
@@ -136,6 +1052,23 @@ int TMan_TaskAdd(const char* taskName){
         }
         
         tasks[tasksAdded].name = taskName;
+        tasks[tasksAdded].handle = xTaskGetHandle(taskName);
+        tasks[tasksAdded].priority = uxTaskPriorityGet(tasks[tasksAdded].handle);
+        vTaskPrioritySet(tasks[tasksAdded].handle, TMAN_LEVEL(tasks[tasksAdded].priority));
+        tasks[tasksAdded].npActive = 0;
+        tasks[tasksAdded].budget = 0;
+        tasks[tasksAdded].budgetLo = 0;
+        tasks[tasksAdded].budgetHi = 0;
+        tasks[tasksAdded].criticality = CRIT_LO;
+        tasks[tasksAdded].droppedJobs = 0;
+        tasks[tasksAdded].reservation = -1;
+        tasks[tasksAdded].threshold = tasks[tasksAdded].priority;
+        tasks[tasksAdded].npRegionUs = 0;
+        tasks[tasksAdded].preemptions = 0;
+        tasks[tasksAdded].throttled = 0;
+        tasks[tasksAdded].releasePending = 0;
+        tasks[tasksAdded].jobDropped = 0;
+        tasks[tasksAdded].budgetOverruns = 0;
         printf("Task %s added!\n", tasks[tasksAdded].name);
         tasksAdded++;
         
@@ -166,7 +1099,9 @@ void Task_Work(void *pvParams) {
         for(i = 0; i < tasksAdded; i++){
             if (tasks[i].name == (const char*) pvParams) {
                 tasks[i].state = BLOCKED;
-                tasks[i].end = TMan_Tick;                
+                STATS_BEGIN(&tasks[i]);
+                tasks[i].end = TMan_Tick;
+                STATS_END(&tasks[i]);
             }
         }
     }
@@ -177,6 +1112,11 @@ void TMan_TaskRegisterAttributes(int index, int phase, int period, int deadline)
     tasks[index].deadline = deadline;
     tasks[index].phase = phase;
     tasks[index].period = period;
+    tasks[index].nominalPeriod = period;
+    tasks[index].maxPeriod = period;
+    elasticTasks -= (tasks[index].elasticity > 0);
+    tasks[index].elasticity = 0;
+    tasks[index].newPeriod = period;
     tasks[index].currentActivation = phase;
     tasks[index].nextActivation = phase;
     tasks[index].numberOfActivation = 0;
@@ -184,6 +1124,8 @@ void TMan_TaskRegisterAttributes(int index, int phase, int period, int deadline)
     tasks[index].precedence = "x";
     tasks[index].state = STARTED;
     tasks[index].end = 0;
+    tasks[index].watchdogArmed = 0;
+    tasks[index].jobMissed = 0;
 }
 
 void TMan_SporadicTaskRegisterAttributes(int index, int deadline, const char* precedence) {
@@ -197,17 +1139,56 @@ void TMan_SporadicTaskRegisterAttributes(int index, int deadline, const char* pr
     tasks[index].precedence = precedence;
     tasks[index].state = STARTED;
     tasks[index].end = 0;
+    tasks[index].watchdogArmed = 0;
+    tasks[index].jobMissed = 0;
 }
 
-void TMan_TaskStats(const char* taskName){
-    char mensagem[80];
-    int i;
+int TMan_TaskStatsRead(const char* taskName, struct TaskStats* stats){
+    unsigned int s1, s2;
+    int i, n;
     for(i = 0; i < tasksAdded; i++) {
         if (tasks[i].name == taskName) {
-            sprintf(mensagem,"Name: %s, nActivatoins: %d, Deadline: \n\r", (const char*) taskName, tasks[i].numberOfActivation, tasks[i].deadlineMissedCounter);
-            if( xQueueSend(msgs, mensagem, 10) != pdPASS ) { }
+            for(n = 0; n < STATS_READ_ATTEMPTS; n++) {
+                s1 = tasks[i].statsSeq;
+                if (s1 & 1) {
+                    taskYIELD();    // atualizacao em curso
+                    continue;
+                }
+                STATS_BARRIER();
+                stats->numberOfActivation = tasks[i].numberOfActivation;
+                stats->deadlineMissedCounter = tasks[i].deadlineMissedCounter;
+                stats->currentActivation = tasks[i].currentActivation;
+                stats->end = tasks[i].end;
+                stats->budgetOverruns = tasks[i].budgetOverruns;
+                stats->droppedJobs = tasks[i].droppedJobs;
+                STATS_BARRIER();
+                s2 = tasks[i].statsSeq;
+                if (s1 == s2) {
+                    return 0;
+                }
+            }
+            // a task atualizou sempre durante a copia: le com as escritas suspensas
+            STATS_BEGIN(&tasks[i]);
+            stats->numberOfActivation = tasks[i].numberOfActivation;
+            stats->deadlineMissedCounter = tasks[i].deadlineMissedCounter;
+            stats->currentActivation = tasks[i].currentActivation;
+            stats->end = tasks[i].end;
+            stats->budgetOverruns = tasks[i].budgetOverruns;
+            stats->droppedJobs = tasks[i].droppedJobs;
+            STATS_END(&tasks[i]);
+            return 0;
         }
     }
+    return -1;
+}
+
+void TMan_TaskStats(const char* taskName){
+    char mensagem[80];
+    struct TaskStats stats;
+    if (TMan_TaskStatsRead(taskName, &stats) == 0) {
+        snprintf(mensagem, sizeof(mensagem), "%s: %d jobs, %d misses, %d overruns, %d dropped\n\r", (const char*) taskName, stats.numberOfActivation, stats.deadlineMissedCounter, stats.budgetOverruns, stats.droppedJobs);
+        if( xQueueSend(msgs, mensagem, 10) != pdPASS ) { }
+    }
 }
 
 void TMan_Print(void *pvParam){
@@ -1,4 +1,16 @@
-#define PRIORITY_TICKS (tskIDLE_PRIORITY + 5)
+/*
+ * prioridades do FreeRTOS das tasks do TMan: as tasks sao criadas com a
+ * prioridade logica p (PRIORITY_TASK_*) e o TMan_TaskAdd passa-as ao
+ * nivel 2p; um job comecado com limiar de preempcao g corre no nivel
+ * 2g + 1, acima de todas as tasks de prioridade <= g, que assim nao
+ * partilham a lista de prontas com ele (nem por time slicing)
+ * as prioridades logicas tem de ser menores que tskIDLE_PRIORITY + 5
+ * e configMAX_PRIORITIES maior que PRIORITY_TICKS
+ */
+#define TMAN_LEVEL(p) (2 * (p))
+#define TMAN_THRESHOLD_LEVEL(g) (2 * (g) + 1)
+
+#define PRIORITY_TICKS (TMAN_LEVEL(tskIDLE_PRIORITY + 5) + 1)
 #define PRIORITY_TASK_A (tskIDLE_PRIORITY + 4)
 #define PRIORITY_TASK_B (tskIDLE_PRIORITY + 4)
 #define PRIORITY_TASK_C (tskIDLE_PRIORITY + 3)
@@ -14,6 +26,59 @@
 #define STARTED -1
 #define NUMBER_OF_TASKS 7
 
+/*
+ * relogio para medir tempo de execucao: core timer do PIC32 (SYSCLK/2)
+ */
+#ifndef TMAN_CLOCK
+#define TMAN_CLOCK() _CP0_GET_COUNT()
+#define TMAN_CLOCK_HZ (configCPU_CLOCK_HZ / 2)
+#endif
+
+/*
+ * o que fazer a um job que excede o orcamento de execucao
+ */
+#define BUDGET_DEMOTE 0                 // continua com prioridade de background
+#define BUDGET_SUSPEND 1                // suspenso ate a proxima ativacao; acaba entao e o job novo comeca logo
+
+/*
+ * criticidade das tasks e modo do sistema (mixed criticality, estilo AMC)
+ */
+#define CRIT_LO 0
+#define CRIT_HI 1
+
+/*
+ * tasks CRIT_LO no modo CRIT_HI: nao sao ativadas (MC_DROP) ou sao
+ * ativadas com prioridade de background (MC_DEGRADE)
+ * com MC_DROP o job em curso e abandonado (conta em droppedJobs); na
+ * ativacao seguinte acaba o que faltava e o job novo comeca logo a seguir
+ */
+#define MC_DROP 0
+#define MC_DEGRADE 1
+#ifndef MC_LO_IN_HI_MODE
+#define MC_LO_IN_HI_MODE MC_DROP
+#endif
+
+/*
+ * reservas periodicas (escalonamento hierarquico)
+ */
+#define NUMBER_OF_RESERVATIONS 4
+#define RES_FP 0                        // escalonador local de prioridades fixas
+#define RES_EDF 1                       // escalonador local EDF
+
+/*
+ * prioridade das regioes nao preemptivas: acima de todas as tasks do
+ * TMan e abaixo do TMan_Ticks (que continua a correr e a ativar jobs,
+ * que so executam no fim da regiao)
+ */
+#define NP_PRIORITY (PRIORITY_TICKS - 1)
+
+/*
+ * tasks elasticas: utilizacao maxima desejada em partes por milhao
+ */
+#ifndef ELASTIC_U_DESIRED
+#define ELASTIC_U_DESIRED 900000
+#endif
+
 
 /*
  definicao da estrutura de uma Task
@@ -30,6 +95,74 @@ struct Task {
     int deadlineMissedCounter;      // counter de falhas de deadline
     int state;                      // estado da task: started, running ou blocked
     int end;                        // TMan Tick em que a task acabou de executar
+    volatile unsigned int statsSeq; // sequencia das estatisticas: impar durante uma atualizacao
+    TickType_t absDeadline;         // deadline absoluta do job atual em ticks do FreeRTOS
+    int watchdogArmed;              // job atual esta na fila de deadlines
+    int jobMissed;                  // job atual ja foi contado como deadline miss pelo watchdog
+    TaskHandle_t handle;            // task do FreeRTOS
+    UBaseType_t priority;           // prioridade nominal (logica) da task
+    uint32_t budget;                // orcamento de execucao por job em ciclos de TMAN_CLOCK (0: sem limite)
+    uint32_t budgetLo;              // orcamento (WCET) no modo CRIT_LO
+    uint32_t budgetHi;              // orcamento (WCET) no modo CRIT_HI
+    int criticality;                // CRIT_LO ou CRIT_HI
+    int droppedJobs;                // counter de ativacoes perdidas (modo CRIT_HI, job anterior travado)
+    int budgetPolicy;               // BUDGET_DEMOTE ou BUDGET_SUSPEND
+    uint32_t jobExec;               // tempo de execucao do job atual em ciclos de TMAN_CLOCK
+    uint32_t switchedIn;            // TMAN_CLOCK quando a task entrou em execucao
+    int throttled;                  // job atual excedeu o orcamento
+    int budgetOverruns;             // counter de jobs que excederam o orcamento
+    int releasePending;             // ativado com o job anterior suspenso pelo orcamento
+    int jobDropped;                 // job abandonado na passagem ao modo CRIT_HI (MC_DROP)
+    int reservation;                // reserva que serve a task (-1: nenhuma)
+    int nominalPeriod;              // periodo nominal (minimo) em TMan Ticks
+    int maxPeriod;                  // periodo maximo em TMan Ticks
+    int elasticity;                 // coeficiente de elasticidade (0: rigida)
+    int newPeriod;                  // periodo a aplicar na proxima ativacao
+    uint32_t execAvg;               // tempo de execucao medio medido em ciclos de TMAN_CLOCK
+    UBaseType_t threshold;          // limiar de preempcao: prioridade do job depois de comecar
+    int npRegionUs;                 // maior regiao nao preemptiva declarada (para a analise)
+    UBaseType_t npSaved;            // prioridade a repor no fim da regiao nao preemptiva atual
+    int npActive;                   // task dentro de uma regiao nao preemptiva
+    int preemptions;                // counter de vezes que um job foi interrompido
+};
+
+/*
+ * definicao de uma reserva periodica: a cada period TMan Ticks as suas
+ * tasks tem direito a budget ciclos de CPU (TMAN_CLOCK); esgotado o
+ * orcamento ficam suspensas ate a reposicao
+ */
+struct Reservation {
+    const char* name;               // nome da reserva (aplicacao)
+    int period;                     // periodo da reserva em TMan Ticks
+    int budgetUs;                   // orcamento por periodo em microsegundos
+    uint32_t budget;                // orcamento por periodo em ciclos de TMAN_CLOCK
+    int policy;                     // RES_FP ou RES_EDF
+    UBaseType_t priority;           // prioridade da reserva; as n tasks usam a banda priority .. priority + n - 1
+    uint32_t consumed;              // ciclos consumidos no periodo atual
+    int nextReplenish;              // TMan Tick da proxima reposicao
+    int depleted;                   // orcamento esgotado
+    int depletions;                 // counter de periodos em que o orcamento esgotou
+};
+
+/*
+ * funcao chamada pelo watchdog no instante em que um job falha a deadline
+ * (ainda em execucao): nome da task, numero do job (numberOfActivation)
+ * e atraso em ticks do FreeRTOS em relacao a deadline
+ * corre na task do servico de timers: deve ser curta e nao bloquear
+ */
+typedef void (*TMan_MissHandler)(const char* taskName, int job, TickType_t lateness);
+
+/*
+ * copia consistente das estatisticas de uma task
+ * (lida por TMan_TaskStats ou pelo debugger)
+ */
+struct TaskStats {
+    int numberOfActivation;
+    int deadlineMissedCounter;
+    int currentActivation;
+    int end;
+    int budgetOverruns;
+    int droppedJobs;
 };
 
 /*
@@ -76,6 +209,109 @@ void TMan_TaskWaitPeriod(void);
  */
 void TMan_TaskStats(const char*);
 
+/*
+ * copia as estatisticas de uma task sem bloquear a task nem o TMan_Ticks
+ * retorna 0 ou -1 se a task nao existe
+ */
+int TMan_TaskStatsRead(const char* taskName, struct TaskStats* stats);
+
+/*
+ * orcamento de execucao por job da task em microsegundos (0: sem limite)
+ * e politica (BUDGET_DEMOTE ou BUDGET_SUSPEND); o orcamento e reposto em
+ * cada ativacao
+ */
+void TMan_TaskSetBudget(int index, int budgetUs, int policy);
+
+/*
+ * criticidade da task e WCET estimados para cada nivel, em microsegundos
+ * CRIT_LO: wcetLoUs e um orcamento normal (wcetHiUs e ignorado)
+ * CRIT_HI: um job que excede wcetLoUs passa o sistema ao modo CRIT_HI, em
+ * que as tasks CRIT_HI tem orcamento wcetHiUs e as CRIT_LO sao largadas
+ * ou degradadas (MC_LO_IN_HI_MODE); o sistema volta ao modo CRIT_LO no
+ * primeiro instante em que nenhuma task tem um job pendente
+ */
+void TMan_TaskSetCriticality(int index, int level, int wcetLoUs, int wcetHiUs, int policy);
+
+/*
+ * criar uma reserva: orcamento de budgetUs microsegundos a cada period
+ * TMan Ticks; as n tasks da reserva correm na banda de prioridades
+ * priority .. priority + n - 1, pela ordem das suas prioridades (RES_FP)
+ * ou das deadlines dos jobs (RES_EDF); o orcamento que sobra guarda-se
+ * ate a reposicao (servidor diferivel)
+ * retorna o indice da reserva ou -1
+ */
+int TMan_ReservationAdd(const char* name, int budgetUs, int period, int policy, UBaseType_t priority);
+
+/*
+ * associar a task a uma reserva (TMan_TaskSetBudget define o WCET usado na analise)
+ */
+void TMan_TaskSetReservation(int index, int reservation);
+
+/*
+ * analise composicional: verifica as tasks de cada reserva so contra a
+ * sbf da reserva e as reservas entre si como servidores diferiveis (FP,
+ * jitter period - budget), com bandas de prioridades sem sobreposicao
+ * imprime o resultado; retorna 0 se tudo e escalonavel, -1 caso contrario
+ * ou se alguma task nao tem orcamento
+ */
+int TMan_ReservationAnalyse(int reservation);
+int TMan_ReservationsAnalyse(void);
+
+/*
+ * task elastica (chamar depois de TMan_TaskRegisterAttributes): o periodo
+ * registado e o nominal e pode ser esticado ate maxPeriod TMan Ticks
+ * quando a utilizacao medida excede ELASTIC_U_DESIRED, na proporcao do
+ * coeficiente de elasticidade; volta ao nominal quando a carga baixa
+ */
+void TMan_TaskSetElastic(int index, int maxPeriod, int elasticity);
+
+/*
+ * preempcao limitada: depois de comecar, um job so pode ser interrompido
+ * por tasks de prioridade acima de threshold (threshold = prioridade
+ * nominal: preempcao normal); npRegionUs e a maior regiao nao preemptiva
+ * (TMan_NonPreemptiveBegin/End) das tasks, usada pela analise
+ * tasks em reservas ou degradadas nao usam o limiar
+ */
+void TMan_TaskSetPreemption(int index, UBaseType_t threshold, int npRegionUs);
+
+/*
+ * regiao nao preemptiva da task que chama (preempcao diferida): os jobs
+ * libertados entretanto so executam no fim; nao pode bloquear la dentro
+ */
+void TMan_NonPreemptiveBegin(void);
+void TMan_NonPreemptiveEnd(void);
+
+/*
+ * analise do tempo de resposta de todas as tasks num CPU, com limiares de
+ * preempcao e regioes nao preemptivas (WCET = TMan_TaskSetBudget)
+ * imprime o resultado; retorna 0 se tudo e escalonavel, -1 caso contrario
+ * ou se alguma task nao tem orcamento
+ */
+int TMan_ResponseTimeAnalyse(void);
+
+/*
+ * modo atual do sistema (CRIT_LO ou CRIT_HI) e numero de mudancas para CRIT_HI
+ */
+int TMan_CriticalityMode(void);
+int TMan_ModeSwitches(void);
+
+/*
+ * contabilizacao do tempo de execucao, a ligar no FreeRTOSConfig.h:
+ *   #define traceTASK_SWITCHED_IN() TMan_TaskSwitchedIn()
+ *   #define traceTASK_SWITCHED_OUT() TMan_TaskSwitchedOut()
+ * e TMan_TickHook() chamada em vApplicationTickHook (configUSE_TICK_HOOK = 1)
+ * verifica o orcamento da task em execucao em cada tick
+ */
+void TMan_TaskSwitchedIn(void);
+void TMan_TaskSwitchedOut(void);
+void TMan_TickHook(void);
+
+/*
+ * definir a funcao chamada quando um job falha a deadline
+ * NULL repoe a funcao por omissao (mensagem na fila de impressao)
+ */
+void TMan_SetMissHandler(TMan_MissHandler handler);
+
 /*
  * verificar se a task pode executar
  */
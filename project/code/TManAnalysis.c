@@ -0,0 +1,218 @@
+/*
+ * analise de escalonabilidade das tasks do TMan
+ * ver TManAnalysis.h
+ */
+#include "TManAnalysis.h"
+
+#define HORIZON_MAX 100000000LL         // limite do hiperperiodo e do periodo ocupado (100 s)
+
+static int64_t Gcd(int64_t a, int64_t b){
+    while (b != 0) {
+        int64_t r = a % b;
+        a = b;
+        b = r;
+    }
+    return a;
+}
+
+static int64_t CeilDiv(int64_t a, int64_t b){
+    return (a + b - 1) / b;
+}
+
+int64_t Analysis_Sbf(int64_t budget, int64_t period, int64_t t){
+    int64_t blackout = period - budget;     // pior caso: a reserva acabou de ser servida
+    int64_t y, rest;
+    if (budget <= 0 || t <= blackout) {
+        return 0;
+    }
+    y = (t - blackout) / period;
+    rest = t - 2 * blackout - y * period;
+    return y * budget + (rest > 0 ? rest : 0);
+}
+
+int64_t Analysis_FpResponseTime(const struct AnalysisTask* tasks, int n, int i){
+    int64_t r = tasks[i].wcet, next;
+    int k;
+    for(;;) {
+        next = tasks[i].wcet;
+        for(k = 0; k < n; k++) {
+            if (k != i && tasks[k].priority >= tasks[i].priority) {
+                next += CeilDiv(r + tasks[k].jitter, tasks[k].period) * tasks[k].wcet;
+            }
+        }
+        if (next > tasks[i].deadline) {
+            return -1;
+        }
+        if (next == r) {
+            return r;
+        }
+        r = next;
+    }
+}
+
+/*
+ * bloqueio da task i por tasks de menor prioridade
+ */
+static int64_t Blocking(const struct AnalysisTask* tasks, int n, int i){
+    int64_t b = 0;
+    int k;
+    for(k = 0; k < n; k++) {
+        if (tasks[k].priority >= tasks[i].priority) {
+            continue;
+        }
+        if (tasks[k].threshold >= tasks[i].priority && tasks[k].wcet > b) {
+            b = tasks[k].wcet;
+        }
+        if (tasks[k].npRegion > b) {
+            b = tasks[k].npRegion;
+        }
+    }
+    return b;
+}
+
+int64_t Analysis_PtResponseTime(const struct AnalysisTask* tasks, int n, int i){
+    int64_t blocking = Blocking(tasks, n, i);
+    int64_t busy, next, start, finish, r, worst = 0;
+    int64_t q, jobs;
+    int k;
+
+    // periodo ocupado de nivel i
+    busy = blocking + tasks[i].wcet;
+    for(;;) {
+        next = blocking;
+        for(k = 0; k < n; k++) {
+            if (k == i) {
+                next += CeilDiv(busy, tasks[k].period) * tasks[k].wcet;
+            }
+            else if (tasks[k].priority >= tasks[i].priority) {
+                next += CeilDiv(busy + tasks[k].jitter, tasks[k].period) * tasks[k].wcet;
+            }
+        }
+        if (next == busy) {
+            break;
+        }
+        busy = next;
+        if (busy > HORIZON_MAX) {
+            return -1;  // nao converge: sobrecarga
+        }
+    }
+    jobs = CeilDiv(busy, tasks[i].period);
+
+    for(q = 0; q < jobs; q++) {
+        // inicio do job q: bloqueio, jobs anteriores e tasks de maior prioridade
+        start = blocking + q * tasks[i].wcet;
+        for(;;) {
+            next = blocking + q * tasks[i].wcet;
+            for(k = 0; k < n; k++) {
+                if (k != i && tasks[k].priority >= tasks[i].priority) {
+                    next += ((start + tasks[k].jitter) / tasks[k].period + 1) * tasks[k].wcet;
+                }
+            }
+            if (next == start) {
+                break;
+            }
+            start = next;
+            if (start - q * tasks[i].period > tasks[i].deadline) {
+                return -1;
+            }
+        }
+        // fim do job q: so as tasks acima do limiar interrompem (sem limiar, tambem as de prioridade igual)
+        finish = start + tasks[i].wcet;
+        for(;;) {
+            next = start + tasks[i].wcet;
+            for(k = 0; k < n; k++) {
+                if (k != i && (tasks[k].priority > tasks[i].threshold
+                        || (tasks[i].threshold == tasks[i].priority && tasks[k].priority == tasks[i].priority))) {
+                    next += (CeilDiv(finish + tasks[k].jitter, tasks[k].period) - ((start + tasks[k].jitter) / tasks[k].period + 1))
+                            * tasks[k].wcet;
+                }
+            }
+            if (next == finish) {
+                break;
+            }
+            finish = next;
+            if (finish - q * tasks[i].period > tasks[i].deadline) {
+                return -1;
+            }
+        }
+        r = finish - q * tasks[i].period;
+        if (r > worst) {
+            worst = r;
+        }
+    }
+    return worst <= tasks[i].deadline ? worst : -1;
+}
+
+/*
+ * procura requerida pela task i e pelas de prioridade maior ou igual em [0, t]
+ */
+static int64_t Rbf(const struct AnalysisTask* tasks, int n, int i, int64_t t){
+    int64_t demand = tasks[i].wcet;
+    int k;
+    for(k = 0; k < n; k++) {
+        if (k != i && tasks[k].priority >= tasks[i].priority) {
+            demand += CeilDiv(t, tasks[k].period) * tasks[k].wcet;
+        }
+    }
+    return demand;
+}
+
+int Analysis_FpSupply(const struct AnalysisTask* tasks, int n, int64_t budget, int64_t period){
+    int i, k;
+    int64_t t, m;
+    for(i = 0; i < n; i++) {
+        // rbf so cresce nas ativacoes: basta testar os multiplos dos periodos e D
+        int ok = (Rbf(tasks, n, i, tasks[i].deadline) <= Analysis_Sbf(budget, period, tasks[i].deadline));
+        for(k = 0; k < n && !ok; k++) {
+            if (k == i || tasks[k].priority < tasks[i].priority) {
+                continue;
+            }
+            for(m = 1; !ok && (t = m * tasks[k].period) < tasks[i].deadline; m++) {
+                ok = (Rbf(tasks, n, i, t) <= Analysis_Sbf(budget, period, t));
+            }
+        }
+        if (!ok) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+int Analysis_EdfSupply(const struct AnalysisTask* tasks, int n, int64_t budget, int64_t period){
+    int64_t horizon = period, maxDeadline = 0, t, demand;
+    int i, k;
+    int64_t used = 0;   // utilizacao x 10^6
+
+    for(i = 0; i < n; i++) {
+        used += tasks[i].wcet * 1000000 / tasks[i].period;
+        if (horizon < HORIZON_MAX) {
+            horizon = horizon / Gcd(horizon, tasks[i].period) * tasks[i].period;
+        }
+        if (tasks[i].deadline > maxDeadline) {
+            maxDeadline = tasks[i].deadline;
+        }
+    }
+    if (n > 0 && used > budget * 1000000 / period) {
+        return 0;       // utilizacao acima da da reserva
+    }
+    if (horizon > HORIZON_MAX) {
+        horizon = HORIZON_MAX;
+    }
+    horizon += maxDeadline;
+
+    // dbf so cresce nas deadlines absolutas
+    for(i = 0; i < n; i++) {
+        for(t = tasks[i].deadline; t <= horizon; t += tasks[i].period) {
+            demand = 0;
+            for(k = 0; k < n; k++) {
+                if (t >= tasks[k].deadline) {
+                    demand += ((t - tasks[k].deadline) / tasks[k].period + 1) * tasks[k].wcet;
+                }
+            }
+            if (demand > Analysis_Sbf(budget, period, t)) {
+                return i;
+            }
+        }
+    }
+    return -1;
+}
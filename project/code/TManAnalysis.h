@@ -0,0 +1,61 @@
+/*
+ * analise de escalonabilidade das tasks do TMan
+ * (C puro, sem FreeRTOS: tambem usada por ferramentas no PC)
+ *
+ * tempos em microsegundos; deadlines menores ou iguais aos periodos
+ */
+#ifndef TMAN_ANALYSIS_H
+#define TMAN_ANALYSIS_H
+
+#include <stdint.h>
+
+/*
+ * task periodica (ou esporadica, com period = tempo minimo entre ativacoes)
+ */
+struct AnalysisTask {
+    int64_t wcet;                   // C
+    int64_t period;                 // T
+    int64_t deadline;               // D
+    int priority;                   // FP: maior valor = maior prioridade
+    int threshold;                  // limiar de preempcao (>= priority)
+    int64_t npRegion;               // maior regiao nao preemptiva
+    int64_t jitter;                 // J (tempos de resposta): atraso maximo da execucao (servidor diferivel: T - C)
+};
+
+/*
+ * supply bound function do modelo de recurso periodico (Shin e Lee):
+ * tempo de CPU garantido em qualquer intervalo de duracao t por uma
+ * reserva com orcamento budget em cada period
+ */
+int64_t Analysis_Sbf(int64_t budget, int64_t period, int64_t t);
+
+/*
+ * tempo de resposta no pior caso da task i com prioridades fixas num
+ * CPU dedicado; -1 se excede a deadline
+ * o jitter das outras tasks conta na interferencia (ceil((R + J) / T) jobs);
+ * o tempo de resposta conta a partir do inicio da execucao possivel
+ */
+int64_t Analysis_FpResponseTime(const struct AnalysisTask* tasks, int n, int i);
+
+/*
+ * tempo de resposta no pior caso da task i com limiares de preempcao
+ * (Wang e Saksena) e regioes nao preemptivas: bloqueio pela maior
+ * regiao nao preemptiva ou job de menor prioridade com limiar >= ao da
+ * task; depois de comecar, so as tasks de prioridade acima do limiar a
+ * interrompem (ou tambem as de prioridade igual, se threshold == priority,
+ * como em Analysis_FpResponseTime); -1 se excede a deadline
+ * com threshold == priority e npRegion == 0 da o mesmo que Analysis_FpResponseTime
+ */
+int64_t Analysis_PtResponseTime(const struct AnalysisTask* tasks, int n, int i);
+
+/*
+ * escalonabilidade das tasks numa reserva (budget, period):
+ * FP: para cada task existe t <= D com rbf(t) <= sbf(t)
+ * EDF: dbf(t) <= sbf(t) em todas as deadlines ate ao hiperperiodo
+ * retorna -1 se escalonavel ou o indice da primeira task que falha
+ * (EDF: a task com a deadline em que falha)
+ */
+int Analysis_FpSupply(const struct AnalysisTask* tasks, int n, int64_t budget, int64_t period);
+int Analysis_EdfSupply(const struct AnalysisTask* tasks, int n, int64_t budget, int64_t period);
+
+#endif
@@ -73,6 +73,11 @@ static void prvSetupHardware( void );
  */
 extern void mainTMan( void );
 
+/*
+ * TMan budget enforcement, checked on every tick
+ */
+extern void TMan_TickHook( void );
+
 /*-----------------------------------------------------------*/
 
 /*
@@ -156,6 +161,7 @@ void vApplicationTickHook( void )
 	added here, but the tick hook is called from an interrupt context, so
 	code must not attempt to block, and only the interrupt safe FreeRTOS API
 	functions can be used (those that end in FromISR()). */
+	TMan_TickHook();
 }
 /*-----------------------------------------------------------*/
 
@@ -14,6 +14,12 @@
 #include "TMan.h"
 #include "semphr.h"
 
+/*
+ * 1: as tasks E e F nao sao interrompidas por C e D depois de comecarem
+ * (comparar as trocas de contexto por hiperperiodo com 0)
+ */
+#define PREEMPTION_THRESHOLDS 0
+
 
 void configUart(){
     // Init UART and redirect stdin/stdot/stderr to UART
@@ -78,6 +84,11 @@ int mainTMan( void *pvParam)
     TMan_TaskRegisterAttributes(3, 1, 3, 2);
     TMan_TaskRegisterAttributes(4, 0, 4, 2);
     TMan_TaskRegisterAttributes(5, 2, 4, 2);
+    
+#if PREEMPTION_THRESHOLDS
+    TMan_TaskSetPreemption(4, PRIORITY_TASK_C, 0);
+    TMan_TaskSetPreemption(5, PRIORITY_TASK_C, 0);
+#endif
   
     
     vTaskStartScheduler();
@@ -0,0 +1,197 @@
+/******************************************************************
+ * DETI/UA/IT - Real-Time Operating Systems course
+ *
+ * Antagonists (co-runners) for the periodic task runner.
+ * See antagonist.h
+ *
+ *****************************************************************/
+#define _GNU_SOURCE
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <spawn.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+
+#include "antagonist.h"
+#include "load.h"
+
+#define ANT_LOAD_NS (10 * 1000 * 1000)	   // Length of each membw/llc burst
+#define ANT_FAULT_BYTES (4 * 1024 * 1024) // Memory mapped by each pagefault round
+
+static const char *antNames[ANT_KINDS] = {"membw", "llc", "pagefault", "fork"};
+
+struct antagonist
+{
+	pthread_t threadid;
+	int kind;
+	struct load load; // Working set of the membw/llc antagonists
+};
+
+static struct antagonist ants[ANT_MAX_THREADS];
+static int nants;
+static volatile int antStop;
+
+/* ***********************************************
+* Antagonist bodies
+* ***********************************************/
+
+// Maps, touches (one write per page) and unmaps anonymous memory
+static void Page_Faults(void)
+{
+	long page = sysconf(_SC_PAGESIZE);
+	char *p;
+	size_t i;
+
+	p = mmap(NULL, ANT_FAULT_BYTES, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (p == MAP_FAILED)
+		return;
+
+	for (i = 0; i < ANT_FAULT_BYTES; i += page)
+		p[i] = 1;
+
+	munmap(p, ANT_FAULT_BYTES);
+}
+
+extern char **environ;
+
+/*
+ * Creates a process running /bin/true, waits for it. posix_spawn()
+ * shares the address space until the exec (vfork semantics): a fork()
+ * would make every page of the mlock'ed runner copy-on-write and
+ * cause minor faults in the RT tasks
+ */
+static void Fork_Exec(void)
+{
+	char *const args[] = {"true", NULL};
+	pid_t pid;
+
+	if (posix_spawn(&pid, "/bin/true", NULL, NULL, args, environ) == 0)
+		waitpid(pid, NULL, 0);
+}
+
+static void *Antagonist_code(void *arg)
+{
+	struct antagonist *ant = arg;
+
+	while (!antStop)
+	{
+		switch (ant->kind)
+		{
+		case ANT_MEMBW:
+		case ANT_LLC:
+			Load_Run(&ant->load);
+			break;
+		case ANT_PAGEFAULT:
+			Page_Faults();
+			break;
+		case ANT_FORK:
+			Fork_Exec();
+			break;
+		}
+	}
+
+	return NULL;
+}
+
+/* ***********************************************
+* Public functions
+* ***********************************************/
+
+int Antagonist_Start(const struct antagonistAttr *attr, int n)
+{
+	pthread_attr_t tattr;
+	cpu_set_t cpuset;
+	struct antagonist *ant;
+	int i, j, err;
+
+	antStop = 0;
+
+	for (i = 0; i < n; i++)
+	{
+		for (j = 0; j < attr[i].count; j++)
+		{
+			if (nants == ANT_MAX_THREADS)
+			{
+				printf("Too many antagonist threads (max %d)\n\r", ANT_MAX_THREADS);
+				goto error;
+			}
+
+			ant = &ants[nants];
+			memset(ant, 0, sizeof(*ant));
+			ant->kind = attr[i].kind;
+			ant->load.kind = LOAD_NONE;
+
+			if (ant->kind == ANT_MEMBW || ant->kind == ANT_LLC)
+			{
+				if (Load_Init(&ant->load, ant->kind == ANT_MEMBW ? LOAD_STREAM : LOAD_CHASE, ANT_LOAD_NS) != 0)
+				{
+					printf("Cannot allocate the working set of antagonist %s\n\r", Antagonist_Name(ant->kind));
+					goto error;
+				}
+			}
+
+			/* Antagonists are not real-time */
+			pthread_attr_init(&tattr);
+			pthread_attr_setinheritsched(&tattr, PTHREAD_EXPLICIT_SCHED);
+			pthread_attr_setschedpolicy(&tattr, SCHED_OTHER);
+			if (attr[i].cpu >= 0)
+			{
+				CPU_ZERO(&cpuset);
+				CPU_SET(attr[i].cpu, &cpuset);
+				pthread_attr_setaffinity_np(&tattr, sizeof(cpuset), &cpuset);
+			}
+
+			err = pthread_create(&ant->threadid, &tattr, Antagonist_code, ant);
+			pthread_attr_destroy(&tattr);
+			if (err != 0)
+			{
+				printf("Error creating antagonist %s [%s]\n\r", Antagonist_Name(ant->kind), strerror(err));
+				Load_Free(&ant->load);
+				goto error;
+			}
+			nants++;
+		}
+	}
+
+	return 0;
+
+error:
+	Antagonist_Stop();
+	return -1;
+}
+
+void Antagonist_Stop(void)
+{
+	int i;
+
+	antStop = 1;
+	for (i = 0; i < nants; i++)
+	{
+		pthread_join(ants[i].threadid, NULL);
+		Load_Free(&ants[i].load);
+	}
+	nants = 0;
+}
+
+const char *Antagonist_Name(int kind)
+{
+	if (kind < 0 || kind >= ANT_KINDS)
+		return "none";
+
+	return antNames[kind];
+}
+
+int Antagonist_Kind(const char *name)
+{
+	int i;
+
+	for (i = 0; i < ANT_KINDS; i++)
+		if (strcmp(name, antNames[i]) == 0)
+			return i;
+
+	return ANT_NONE;
+}
@@ -0,0 +1,52 @@
+/******************************************************************
+ * DETI/UA/IT - Real-Time Operating Systems course
+ *
+ * Antagonists (co-runners) for the periodic task runner: non-RT
+ * (SCHED_OTHER) threads that stress the resources shared with the
+ * real-time tasks, usually from sibling cores.
+ *
+ *   membw     - memory bandwidth hog (stream kernel of load.h)
+ *   llc       - last-level cache thrasher (pointer chase of load.h)
+ *   pagefault - maps, touches and unmaps anonymous memory
+ *   fork      - process creation storm (posix_spawn of /bin/true)
+ *
+ *****************************************************************/
+#ifndef ANTAGONIST_H
+#define ANTAGONIST_H
+
+#include <pthread.h>
+
+enum antagonistKind
+{
+	ANT_NONE = -1,
+	ANT_MEMBW,
+	ANT_LLC,
+	ANT_PAGEFAULT,
+	ANT_FORK,
+	ANT_KINDS
+};
+
+#define ANT_MAX_THREADS 32 // Maximum number of antagonist threads
+
+/* One "antagonist" entry of the task-set file */
+struct antagonistAttr
+{
+	int kind;  // One of enum antagonistKind
+	int cpu;   // CPU the threads are pinned to (-1: no affinity)
+	int count; // Number of threads
+};
+
+/*
+ * Starts the threads of n antagonist entries. Returns 0 on success,
+ * otherwise stops the threads already started and returns -1.
+ */
+int Antagonist_Start(const struct antagonistAttr *attr, int n);
+
+/* Stops and joins all antagonist threads */
+void Antagonist_Stop(void);
+
+/* Kind <-> name conversions. Antagonist_Kind() returns ANT_NONE if unknown */
+const char *Antagonist_Name(int kind);
+int Antagonist_Kind(const char *name);
+
+#endif
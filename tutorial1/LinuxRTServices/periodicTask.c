@@ -3,7 +3,35 @@
  * DETI/UA/IT - Real-Time Operating Systems course
  *
  * Base code for periodic thread execution using clock_nanosleep
- * Assumes that periods and execution times are below 1 second
+ * (or the other release mechanisms of release.h)
+ *
+ * Runs the task set described in a task-set file (see taskset.h),
+ * one thread per task, all released from a common start time.
+ * main() supervises the tasks: it blocks until SIGINT/SIGTERM (or
+ * the optional run duration elapses), stops and joins all threads
+ * and prints the final statistics.
+ *
+ * Each task records, in signed 64-bit ns (see rttime.h), the wake-up latency (actual minus
+ * intended release), inter-arrival time, execution time and response
+ * time of its jobs in log-linear histograms. With -o PREFIX they are
+ * exported to PREFIX.csv (summary), PREFIX_hist.csv (buckets) and
+ * PREFIX.json at exit and whenever SIGUSR1 is received.
+ *
+ * Antagonists listed in the task-set file are started with the
+ * tasks or, with -b SECONDS, after a baseline run of that length.
+ * The baseline histograms are then kept apart and the final report
+ * shows the inflation of wake-up latency and execution time.
+ *
+ * All memory is locked, the stacks of the tasks are prefaulted and
+ * the per-task block pools (task attribute "pool") are carved from a
+ * prefaulted arena, so that the jobs run without page faults. The
+ * page faults of each task at start-up and in steady state (after
+ * BOOT_ITER jobs) are reported.
+ *
+ * While running, the counters and histograms of the tasks are also
+ * published in shared memory (-s NAME, default LIVE_NAME, see
+ * livestats.h), where rtmon can watch them without disturbing the
+ * tasks.
  *    
  *
  *****************************************************************/
@@ -19,107 +47,307 @@
 #include <errno.h>
 #include <signal.h> // Timers
 #include <stdint.h>
+#include <inttypes.h>
 #include <unistd.h>
 #include <math.h>
+#include <sys/signalfd.h>
+
+#include "taskset.h"
+#include "schedDeadline.h"
+#include "reporter.h"
+#include "histogram.h"
+#include "load.h"
+#include "antagonist.h"
+#include "release.h"
+#include "rtmem.h"
+#include "pool.h"
+#include "rttime.h"
+#include "livestats.h"
 
 /* ***********************************************
 * App specific defines
 * ***********************************************/
-#define NS_IN_SEC 1000000000L
+#define START_DELAY_NS (500 * 1000 * 1000) // Delay from task creation to the common start time
+
+#define TASK_STACK_SIZE (256 * 1024)	// Stack of the task threads (locked as a whole)
+#define TASK_STACK_PREFAULT (64 * 1024) // Stack touched before the first job
 
-#define PERIOD_NS (100 * 1000 * 1000) // Period (ns component)
-#define PERIOD_S (0)				  // Period (seconds component)
+#define SIG_WAKEUP SIGUSR2 // Interrupts the sleep of the tasks at shutdown
+
+#define LIVE_NAME "/rtstats" // Shared memory with the live statistics (see livestats.h)
 
 #define BOOT_ITER 10 // Number of activations for warm-up                        \
 					 // There is an initial transient in which first activations \
 					 // often have an irregular behaviour (cache issues, ..)
 
+/* Messages posted by the tasks to the reporter thread */
+#define MSG_IAT 0		// Inter-arrival time update: a = min, b = max
+#define MSG_THROTTLED 1 // SCHED_DEADLINE overruns: a = count
+
+/* Per-job measurements */
+enum metric
+{
+	M_WAKEUP, // Wake-up latency: actual minus intended release time
+	M_IAT,	  // Inter-arrival time
+	M_EXEC,	  // Execution time
+	M_RESP,	  // Response time: finish minus intended release time
+	M_SPIN,	  // Busy-wait before the release (release=hybrid only)
+	METRICS
+};
+
+static const char *metricNames[METRICS] = {"wakeup", "iat", "exec", "response", "spin"};
+
+/* ***********************************************
+* Task context
+* ***********************************************/
+struct taskCtx
+{
+	struct taskAttr attr;  // Attributes read from the task-set file
+	pthread_t threadid;	   // Thread running the task
+	int64_t start;		   // Common start time (absolute)
+	struct histogram hist[METRICS]; // Measurements, indexed by enum metric
+	struct histogram base[METRICS]; // Baseline measurements (before the antagonists started)
+	int hasBaseline;				// base[] is valid
+	int activations;	   // Number of jobs released
+	int deadlineMissed;	   // Number of jobs that finished after their deadline
+	int throttled;		   // SCHED_DEADLINE runtime overruns (SIGXCPU), updated asynchronously
+	struct reportChannel *channel; // Messages to the reporter thread
+	struct load load;			   // Workload executed by each job
+	struct release release;		   // Release mechanism state
+	struct pool pool;			   // Per-job allocations (if attr.poolBlocks > 0)
+	struct rtFaults startFaults;   // Page faults before the steady state (first BOOT_ITER jobs)
+	struct rtFaults steadyFaults;  // Page faults in steady state
+	struct liveTask *live;		   // Live statistics in shared memory (NULL: not published)
+};
+
 /* ***********************************************
 * Prototypes
 * ***********************************************/
-void Heavy_Work(void);
-struct timespec TsAdd(struct timespec ts1, struct timespec ts2);
-struct timespec TsSub(struct timespec ts1, struct timespec ts2);
+void Format_Msg(const struct reportMsg *msg);
+void Throttle_Handler(int sig);
+void Wakeup_Handler(int sig);
+int Supervise(int duration, const char *prefix);
+void Print_Stats(void);
+void Print_Inflation(void);
+int Export_Stats(const char *prefix);
 
 /* ***********************************************
 * Global variables
 * ***********************************************/
-uint64_t min_iat, max_iat; // Hold the minium/maximum observed inter arrival time
+struct taskCtx tasks[TASKSET_MAX_TASKS]; // Tasks of the running task set
+int ntasks;								 // Number of tasks in the task set
+volatile sig_atomic_t stop;				 // Set by the supervisor to terminate the tasks
+volatile int endOfBaseline;				 // Set by the supervisor when the antagonists start
+
+static __thread struct taskCtx *self; // Task run by the calling thread (for signal handlers)
 
 /* *************************
-* Thread_1 code 
+* Measurements
 * **************************/
 
-void *Thread_1_code(void *arg)
+// Adds a measurement of the current job to the task histograms and to its live statistics
+static inline void Record(struct taskCtx *task, enum metric m, int64_t value)
 {
-	/* Timespec variables to manage time */
-	struct timespec ts, // thread next activation time (absolute)
-		ta,				// activation time of current thread activation (absolute)
-		tit,			// thread inter-arrival time,
-		ta_ant,			// activation time of last instance (absolute),
-		tp;				// Thread period
+	Hist_Add(&task->hist[m], value);
+	if (task->live != NULL)
+		Hist_Add(&task->live->hist[m], value);
+}
+
+// Starts an update of the live statistics of a task
+static inline void Publish_Begin(struct taskCtx *task)
+{
+	if (task->live != NULL)
+		Live_Begin(task->live);
+}
+
+// Completes an update of the live statistics of a task, with its current counters
+static inline void Publish_End(struct taskCtx *task)
+{
+	if (task->live == NULL)
+		return;
+	task->live->jobs = task->activations;
+	task->live->deadlineMisses = task->deadlineMissed;
+	task->live->skipped = task->release.skipped;
+	Live_End(task->live);
+}
+
+/* *************************
+* Periodic task code
+* **************************/
+
+void *Task_code(void *arg)
+{
+	struct taskCtx *task = (struct taskCtx *)arg;
+
+	/* Instants in ns (CLOCK_MONOTONIC) */
+	int64_t tsNs,	 // thread next activation time (absolute)
+		taNs,		 // activation time of current thread activation (absolute)
+		tfNs,		 // finish time of current thread activation (absolute)
+		taAntNs = 0; // activation time of the previous activation
+	int64_t period = task->attr.period_ns;
+	uint64_t stamp;	 // Timestamp of the activation, for the execution time
 
 	/* Other variables */
-	int niter = 0; // Activation counter
-	int update;	   // Flag to signal that min/max should be updated
+	int niter = 0;	// Activation counter
+	int update = 0; // Flag to signal that min/max should be updated
+	int throttled = 0; // Throttling events already reported
+	struct reportMsg msg;
+	int err;
+	int released = 1; // Releases since the previous job (more than 1 if late)
+	int dl = (task->attr.policy == SCHED_DEADLINE); // Task is served by a CBS
+	int m;
+	struct rtFaults f0, f1; // Page faults at thread start, at the start of the steady state
+	char *block;
 
-	/* Set absolute activation time of first instance */
-	tp.tv_nsec = PERIOD_NS;
-	tp.tv_sec = PERIOD_S;
-	clock_gettime(CLOCK_MONOTONIC, &ts);
-	ts = TsAdd(ts, tp);
+	RtMem_Faults(&f0);
+	RtMem_PrefaultStack(TASK_STACK_PREFAULT);
 
-	//printf("\n%d\n\n", gettid());
+	self = task;
+	strncpy(msg.name, task->attr.name, REPORT_NAME_LEN - 1);
+	msg.name[REPORT_NAME_LEN - 1] = '\0';
+
+	/* SCHED_DEADLINE has no pthread attribute, the thread moves itself */
+	if (dl)
+	{
+		err = SchedDl_SetSelf(task->attr.runtime_ns, task->attr.deadline_ns, task->attr.period_ns);
+		if (err != 0)
+		{
+			printf("Task %s: SCHED_DEADLINE refused by the kernel: %s\n\r", task->attr.name, SchedDl_StrError(err));
+			return NULL;
+		}
+	}
+
+	/* Set absolute activation time of first instance */
+	tsNs = task->start + task->attr.phase_ns;
+	if (Release_Init(&task->release, task->attr.release, tsNs, period) != 0)
+	{
+		printf("Task %s: cannot arm the %s release: %s\n\r", task->attr.name, Release_Name(task->attr.release), strerror(errno));
+		return NULL;
+	}
 
 	/* Periodic jobs ...*/
 	while (1)
 	{
 
-		/* Wait until next cycle */
-		clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL);
-		clock_gettime(CLOCK_MONOTONIC, &ta);
-		ts = TsAdd(ts, tp);
-
-		niter++; // Coount number of activations
+		/* Wait until next cycle. A SCHED_DEADLINE task only sleeps until its
+		 * first release, later releases are the CBS replenishments that follow
+		 * the sched_yield() at the end of each job */
+		if (!dl || niter == 0)
+			released = Release_Wait(&task->release);
+		taNs = Time_Now();
+		stamp = Time_StampStart();
+
+		if (stop)
+			break; // Shutdown requested by the supervisor
+		if (released < 0)
+		{
+			if (errno == EINTR)
+				continue; // Interrupted by some other signal
+			printf("Task %s: waiting for the %s release failed: %s\n\r", task->attr.name,
+				   Release_Name(task->attr.release), strerror(errno));
+			break;
+		}
 
-		/* Compute latency and jitter */
-		if (niter == 1)
-			ta_ant = ta; // Init ta_ant at first activation
+		/* Timer releases missed while the previous job was late are skipped */
+		if (released > 1)
+			tsNs += (released - 1) * period;
 
-		tit = TsSub(ta, ta_ant); // Compute time since last activation
+		/* The CBS periods of a SCHED_DEADLINE task start at its first wake-up */
+		if (dl && niter == 0)
+			tsNs = taNs;
 
+		niter++; // Coount number of activations
+		task->activations = niter;
 		if (niter == BOOT_ITER)
-		{ // Boot time finsihed. Init max/min variables
-			min_iat = tit.tv_nsec;
-			max_iat = tit.tv_nsec;
-			update = 1;
-		}
-		else if (niter > BOOT_ITER)
-		{ // Update max/min, if boot time elapsed
-			if (tit.tv_nsec < min_iat)
-			{
-				min_iat = tit.tv_nsec;
-				update = 1;
-			}
-			if (tit.tv_nsec > max_iat)
+			RtMem_Faults(&f1);
+
+		Publish_Begin(task);
+
+		/* Antagonists started: what was measured so far is the baseline */
+		if (endOfBaseline && !task->hasBaseline)
+		{
+			for (m = 0; m < METRICS; m++)
 			{
-				max_iat = tit.tv_nsec;
-				update = 1;
+				task->base[m] = task->hist[m];
+				Hist_Init(&task->hist[m]);
+				if (task->live != NULL)
+					Hist_Init(&task->live->hist[m]);
 			}
+			task->hasBaseline = 1;
+		}
+
+		/* Compute latency and jitter, if boot time elapsed */
+		if (niter >= BOOT_ITER)
+		{
+			Record(task, M_WAKEUP, taNs - tsNs);
+			Record(task, M_IAT, taNs - taAntNs);
+			if (task->attr.release == REL_HYBRID)
+				Record(task, M_SPIN, task->release.spin_ns);
+			update = (niter == BOOT_ITER || task->hist[M_IAT].min == taNs - taAntNs || task->hist[M_IAT].max == taNs - taAntNs);
 		}
-		ta_ant = ta; // Update ta_ant
+		taAntNs = taNs; // Update ta_ant
 
-		/* Print maximum/minimum inter-arrival time */
+		Publish_End(task);
+
+		/* Report maximum/minimum inter-arrival time */
 		if (update)
 		{
-			printf("Task %s inter-arrival time: min: %lu / max: %lu\n\r", (char *)arg, min_iat, max_iat);
+			msg.type = MSG_IAT;
+			msg.a = task->hist[M_IAT].min;
+			msg.b = task->hist[M_IAT].max;
+			Report_Post(task->channel, &msg);
 			update = 0;
 		}
 
-		/* Do the actual processing */
-		Heavy_Work();
+		/* Do the actual processing, with a job buffer from the pool */
+		block = (task->attr.poolBlocks > 0 ? Pool_Alloc(&task->pool) : NULL);
+		if (block != NULL)
+			memset(block, niter, task->attr.poolBlockSize);
+		Load_Run(&task->load);
+		if (block != NULL)
+			Pool_Free(&task->pool, block);
+
+		/* Execution and response times, deadline check. The job is timed
+		 * with the (cheaper) timestamps, relative to its activation */
+		tfNs = taNs + Time_StampNs(stamp, Time_StampEnd());
+		Publish_Begin(task);
+		if (niter >= BOOT_ITER)
+		{
+			Record(task, M_EXEC, tfNs - taNs);
+			Record(task, M_RESP, tfNs - tsNs);
+		}
+		if (tfNs - tsNs > task->attr.deadline_ns)
+			task->deadlineMissed++;
+		Publish_End(task);
+
+		tsNs += period;
+
+		if (dl)
+		{
+			/* Report runtime overruns signalled by the kernel */
+			if (__atomic_load_n(&task->throttled, __ATOMIC_RELAXED) != throttled)
+			{
+				throttled = __atomic_load_n(&task->throttled, __ATOMIC_RELAXED);
+				msg.type = MSG_THROTTLED;
+				msg.a = throttled;
+				Report_Post(task->channel, &msg);
+			}
+
+			/* Job done: give back the remaining runtime until the next period */
+			sched_yield();
+		}
 	}
 
+	Release_Free(&task->release);
+
+	/* Faults of the boot jobs (and thread set-up) vs steady state */
+	if (niter < BOOT_ITER)
+		RtMem_Faults(&f1);
+	RtMem_Faults(&task->steadyFaults);
+	task->startFaults.minor = f1.minor - f0.minor;
+	task->startFaults.major = f1.major - f0.major;
+	task->steadyFaults.minor -= f1.minor;
+	task->steadyFaults.major -= f1.major;
 	return NULL;
 }
 
@@ -129,157 +357,479 @@ void *Thread_1_code(void *arg)
 
 int main(int argc, char *argv[])
 {
-	int err;
-	pthread_t threadid;
-	char procname[40];
-	int priority;
+	int err, i, m;
+	struct sched_param parm;
+	pthread_attr_t attr;
+	cpu_set_t cpuset, mainset;
+	static struct taskSet taskset;
+	int64_t start;
+	struct sigaction sa;
+	sigset_t sigset;
+	int duration = 0, baseline = 0;
+	int dispatchPrio;
+	size_t arenaSize;
+	const char *prefix = NULL;
+	const char *liveName = LIVE_NAME;
+	struct liveStats *live;
+	int opt;
 
 	/* Process input args */
-	if (argc != 3)
+	while ((opt = getopt(argc, argv, "b:d:o:s:")) != -1)
 	{
-		printf("Usage: %s PROCNAME PRIORITY, where PROCNAME is a string\n\r", argv[0]);
+		switch (opt)
+		{
+		case 'b':
+			baseline = atoi(optarg);
+			break;
+		case 'd':
+			duration = atoi(optarg);
+			break;
+		case 'o':
+			prefix = optarg;
+			break;
+		case 's':
+			liveName = optarg;
+			break;
+		default:
+			optind = argc; // Print usage
+		}
+	}
+	if (optind != argc - 1)
+	{
+		printf("Usage: %s [-b BASELINE] [-d DURATION] [-o PREFIX] [-s NAME] TASKSET, where TASKSET is a task-set file (see taskset.h),\n\r"
+			   "  BASELINE the run time in seconds before the antagonists start (default: 0),\n\r"
+			   "  DURATION the run time in seconds with antagonists (default: until SIGINT/SIGTERM),\n\r"
+			   "  PREFIX the name of the CSV/JSON statistics files\n\r"
+			   "  and NAME the shared memory with the live statistics (default: %s)\n\r", argv[0], LIVE_NAME);
 		return -1;
 	}
 
-	strcpy(procname, argv[1]);
+	ntasks = TaskSet_Load(argv[optind], &taskset);
+	if (ntasks <= 0)
+	{
+		printf("No tasks to run\n\r");
+		return -1;
+	}
 
-	// priority = 42;			// A1
-	priority = atoi(argv[2]); // A2
-	struct sched_param parm;
-	pthread_attr_t attr;
-	pthread_attr_init(&attr);
-	pthread_attr_setinheritsched(&attr,
-								 PTHREAD_EXPLICIT_SCHED);
-	pthread_attr_setschedpolicy(&attr, SCHED_FIFO);
-	parm.sched_priority = priority;
-	pthread_attr_setschedparam(&attr, &parm);
+	/* SCHED_DEADLINE tasks get SIGXCPU whenever they exhaust their runtime */
+	memset(&sa, 0, sizeof(sa));
+	sa.sa_handler = Throttle_Handler;
+	sigemptyset(&sa.sa_mask);
+	sa.sa_flags = SA_RESTART;
+	sigaction(SIGXCPU, &sa, NULL);
+
+	/* SIG_WAKEUP only interrupts clock_nanosleep(), hence no SA_RESTART */
+	sa.sa_handler = Wakeup_Handler;
+	sa.sa_flags = 0;
+	sigaction(SIG_WAKEUP, &sa, NULL);
+
+	/* Termination signals are only received by the supervisor (via signalfd).
+	 * Block them before creating the tasks, so that the threads inherit the mask */
+	sigemptyset(&sigset);
+	sigaddset(&sigset, SIGINT);
+	sigaddset(&sigset, SIGTERM);
+	sigaddset(&sigset, SIGALRM);
+	sigaddset(&sigset, SIGUSR1);
+	pthread_sigmask(SIG_BLOCK, &sigset, NULL);
+
+	/* All console output of the tasks goes through the reporter */
+	err = Reporter_Start(Format_Msg);
+	if (err != 0)
+	{
+		printf("Error creating reporter thread [%s]\n\r", strerror(err));
+		return -1;
+	}
+
+	/* No paging from now on: locks the load buffers, thread stacks, ... */
+	err = RtMem_Lock();
+	if (err != 0)
+		printf("Warning: cannot lock memory [%s], expect page faults\n\r", strerror(err));
+
+	/* Arena holding the per-task pools */
+	arenaSize = 0;
+	for (i = 0; i < ntasks; i++)
+		if (taskset.task[i].poolBlocks > 0)
+			arenaSize += Pool_Size(taskset.task[i].poolBlockSize, taskset.task[i].poolBlocks) + RTMEM_ALIGN;
+	if (arenaSize > 0)
+	{
+		err = RtMem_ArenaInit(arenaSize);
+		if (err != 0)
+		{
+			printf("Cannot allocate the %zu byte arena [%s]\n\r", arenaSize, strerror(err));
+			return -1;
+		}
+	}
+
+	/* Live statistics, for rtmon */
+	live = Live_Create(liveName, metricNames, METRICS);
+	if (live == NULL)
+		printf("Warning: cannot publish the live statistics in %s [%s]\n\r", liveName, strerror(errno));
+
+	/* Timestamps for the measurements (and the load calibration) */
+	if (Time_TscInit())
+		printf("Timestamps: invariant TSC, %" PRIu64 " Hz\n\r", timeTsc.hz);
+	else
+		printf("Timestamps: CLOCK_MONOTONIC (no usable invariant TSC)\n\r");
+
+	/* Calibrate the workloads, each one on the CPU of its task */
+	pthread_getaffinity_np(pthread_self(), sizeof(mainset), &mainset);
+	for (i = 0; i < ntasks; i++)
+	{
+		tasks[i].attr = taskset.task[i];
+
+		if (tasks[i].attr.cpu >= 0)
+		{
+			CPU_ZERO(&cpuset);
+			CPU_SET(tasks[i].attr.cpu, &cpuset);
+			pthread_setaffinity_np(pthread_self(), sizeof(cpuset), &cpuset);
+		}
+
+		if (Load_Init(&tasks[i].load, tasks[i].attr.loadKind, tasks[i].attr.load_ns) != 0)
+		{
+			printf("Task %s: cannot allocate the %s workload\n\r", tasks[i].attr.name, Load_Name(tasks[i].attr.loadKind));
+			return -1;
+		}
+		printf("Task %s: load %s, %ld ns = %ld units\n\r", tasks[i].attr.name, Load_Name(tasks[i].load.kind),
+			   tasks[i].load.target_ns, tasks[i].load.units);
 
-	// A3
-	cpu_set_t cpuset;
+		pthread_setaffinity_np(pthread_self(), sizeof(mainset), &mainset);
 
-	/* Forces the process to execute only on CPU0 */
-	CPU_ZERO(&cpuset);
-	CPU_SET(0, &cpuset);
+		if (tasks[i].attr.poolBlocks > 0 &&
+			Pool_Init(&tasks[i].pool, RtMem_Alloc(Pool_Size(tasks[i].attr.poolBlockSize, tasks[i].attr.poolBlocks)),
+					  tasks[i].attr.poolBlockSize, tasks[i].attr.poolBlocks) != 0)
+		{
+			printf("Task %s: cannot create the block pool\n\r", tasks[i].attr.name);
+			return -1;
+		}
+	}
 
-	if (sched_setaffinity(0, sizeof(cpuset), &cpuset))
+	/* Timerfds released through epoll are served by one dispatcher thread,
+	 * which must preempt all the tasks it releases */
+	dispatchPrio = -1;
+	for (i = 0; i < ntasks; i++)
+		if (tasks[i].attr.release == REL_EPOLL && tasks[i].attr.priority > dispatchPrio)
+			dispatchPrio = tasks[i].attr.priority;
+	if (dispatchPrio >= 0)
 	{
-		printf("\n Lock of process to CPU0 failed!!!");
-		return (1);
+		dispatchPrio = (dispatchPrio < sched_get_priority_max(SCHED_FIFO) ? dispatchPrio + 1 : dispatchPrio);
+		err = Release_StartDispatcher(dispatchPrio, -1);
+		if (err != 0)
+		{
+			printf("Error creating the epoll dispatcher [%s]\n\r", strerror(err));
+			return -1;
+		}
 	}
 
-	/* Create periodic thread/task */
-	//err = pthread_create(&threadid, NULL, Thread_1_code, &procname);
-	err = pthread_create(&threadid, &attr, Thread_1_code, &procname); // A1, A2, A3
+	/* All tasks share the same time origin, so that phases are meaningful */
+	start = Time_Now() + START_DELAY_NS;
 
-	if (err != 0)
+	/* Create one periodic thread per task */
+	for (i = 0; i < ntasks; i++)
 	{
-		printf("\n\r Error creating Thread [%s]", strerror(err));
-		return -1;
+		tasks[i].start = start;
+		tasks[i].channel = Reporter_Channel();
+		tasks[i].live = Live_AddTask(live, tasks[i].attr.name, tasks[i].attr.period_ns, tasks[i].attr.deadline_ns);
+		for (m = 0; m < METRICS; m++)
+			Hist_Init(&tasks[i].hist[m]);
+
+		pthread_attr_init(&attr);
+		pthread_attr_setstacksize(&attr, TASK_STACK_SIZE);
+		if (tasks[i].attr.policy != SCHED_DEADLINE)
+		{
+			pthread_attr_setinheritsched(&attr, PTHREAD_EXPLICIT_SCHED);
+			pthread_attr_setschedpolicy(&attr, tasks[i].attr.policy);
+			parm.sched_priority = tasks[i].attr.priority;
+			pthread_attr_setschedparam(&attr, &parm);
+		}
+
+		/* Forces the thread to execute only on its CPU */
+		if (tasks[i].attr.cpu >= 0)
+		{
+			CPU_ZERO(&cpuset);
+			CPU_SET(tasks[i].attr.cpu, &cpuset);
+			pthread_attr_setaffinity_np(&attr, sizeof(cpuset), &cpuset);
+		}
+
+		err = pthread_create(&tasks[i].threadid, &attr, Task_code, &tasks[i]);
+		pthread_attr_destroy(&attr);
+
+		if (err != 0)
+		{
+			printf("\n\r Error creating Thread %s [%s]", tasks[i].attr.name, strerror(err));
+			return -1;
+		}
+
+		if (tasks[i].attr.policy == SCHED_DEADLINE)
+			printf("Task %s: period %ld ns, phase %ld ns, deadline %ld ns, runtime %ld ns (SCHED_DEADLINE)\n\r",
+				   tasks[i].attr.name, tasks[i].attr.period_ns, tasks[i].attr.phase_ns,
+				   tasks[i].attr.deadline_ns, tasks[i].attr.runtime_ns);
+		else
+			printf("Task %s: period %ld ns, phase %ld ns, deadline %ld ns, priority %d, cpu %d, release %s\n\r",
+				   tasks[i].attr.name, tasks[i].attr.period_ns, tasks[i].attr.phase_ns,
+				   tasks[i].attr.deadline_ns, tasks[i].attr.priority, tasks[i].attr.cpu,
+				   Release_Name(tasks[i].attr.release));
 	}
-	else
-		while (1)
-			; // Ok. Thread shall run
 
-	/* Last thing that main() should do */
-	pthread_exit(NULL);
+	/* Ok. Threads shall run, wait until they have to stop. With a baseline,
+	 * the antagonists only start if it was not interrupted */
+	err = 0;
+	if (taskset.nantagonists == 0 && baseline > 0)
+	{
+		printf("Warning: no antagonists in the task set, ignoring the baseline\n\r");
+		baseline = 0;
+	}
+	if (taskset.nantagonists > 0 && baseline > 0)
+	{
+		err = Supervise(baseline, prefix);
+		printf("Baseline %s, starting antagonists\n\r", err == SIGALRM ? "done" : "interrupted");
+	}
+	if (err == 0 || err == SIGALRM)
+	{
+		endOfBaseline = (baseline > 0);
+		if (Antagonist_Start(taskset.antagonist, taskset.nantagonists) == 0)
+			err = Supervise(duration, prefix);
+		else
+			err = -1;
+		Antagonist_Stop();
+	}
 
-	return 0;
+	/* Stop the tasks and wait for them */
+	err = (err < 0 ? -1 : 0);
+	stop = 1;
+	for (i = 0; i < ntasks; i++)
+		pthread_kill(tasks[i].threadid, SIG_WAKEUP);
+	for (i = 0; i < ntasks; i++)
+		pthread_join(tasks[i].threadid, NULL);
+	Release_StopDispatcher();
+	Reporter_Stop();
+
+	Print_Stats();
+	Print_Inflation();
+	if (prefix != NULL && Export_Stats(prefix) != 0)
+		err = -1;
+
+	for (i = 0; i < ntasks; i++)
+		Load_Free(&tasks[i].load);
+	RtMem_ArenaFree();
+	Live_Destroy(live, liveName);
+
+	return err;
 }
 
-/* ***********************************************
-* Auxiliary functions 
-* ************************************************/
+/* *************************
+* Supervisor
+* **************************/
 
-// Task load. In the case integrates numerically a function
-#define f(x) 1 / (1 + pow(x, 2)) /* Define function to integrate*/
-void Heavy_Work(void)
+// Blocks until SIGINT/SIGTERM or, if duration > 0, after duration seconds.
+// SIGUSR1 dumps the statistics collected so far (exported if prefix is set).
+// Returns the signal that ended the wait, or -1 on error
+int Supervise(int duration, const char *prefix)
 {
-	float lower, upper, integration = 0.0, stepSize, k;
-	int i, subInterval;
-
-	struct timespec ts,	  // Function start time
-		tf;				  // Function finish time
-	static int first = 0; // Flag to signal first execution
-
-	/* Get start time */
-	clock_gettime(CLOCK_MONOTONIC, &ts);
-
-	/* Integration parameters */
-	/* These values can be tunned to cause a desired load*/
-	lower = 0;
-	upper = 100;
-	// subInterval = 1000000;
-	subInterval = 500000; // tune function to take an execution time around 20 ms
-
-	/* Calculation */
-	/* Finding step size */
-	stepSize = (upper - lower) / subInterval;
-
-	/* Finding Integration Value */
-	integration = f(lower) + f(upper);
-	for (i = 1; i <= subInterval - 1; i++)
+	sigset_t sigset;
+	struct signalfd_siginfo info;
+	int fd;
+
+	sigemptyset(&sigset);
+	sigaddset(&sigset, SIGINT);
+	sigaddset(&sigset, SIGTERM);
+	sigaddset(&sigset, SIGALRM);
+	sigaddset(&sigset, SIGUSR1);
+
+	fd = signalfd(-1, &sigset, SFD_CLOEXEC);
+	if (fd < 0)
 	{
-		k = lower + i * stepSize;
-		integration = integration + 2 * f(k);
+		printf("signalfd failed [%s]\n\r", strerror(errno));
+		return -1;
 	}
-	integration = integration * stepSize / 2;
 
-	/* Get finish time and show results */
-	if (!first)
+	if (duration > 0)
+		alarm(duration);
+
+	while (1)
 	{
-		clock_gettime(CLOCK_MONOTONIC, &tf);
-		tf = TsSub(tf, ts); // Compute time difference form start to finish
+		if (read(fd, &info, sizeof(info)) != sizeof(info))
+		{
+			if (errno == EINTR)
+				continue;
+			printf("Reading signalfd failed [%s]\n\r", strerror(errno));
+			close(fd);
+			return -1;
+		}
 
-		printf("Integration value is: %.3f. It took %9lu ns to compute.\n", integration, tf.tv_nsec);
+		if (info.ssi_signo != SIGUSR1)
+			break;
 
-		first = 1;
+		/* Snapshot while the tasks keep running (values may be slightly inconsistent) */
+		Print_Stats();
+		if (prefix != NULL)
+			Export_Stats(prefix);
 	}
+
+	if (info.ssi_signo != SIGALRM || duration > 0)
+		printf("\n\rEnd of run (%s) ...\n\r", strsignal(info.ssi_signo));
+	close(fd);
+
+	return info.ssi_signo;
 }
 
-// Adds two timespect variables
-struct timespec TsAdd(struct timespec ts1, struct timespec ts2)
+// Formats the messages posted by the tasks (runs in the reporter thread)
+void Format_Msg(const struct reportMsg *msg)
 {
+	switch (msg->type)
+	{
+	case MSG_IAT:
+		printf("Task %s inter-arrival time: min: %ld / max: %ld\n\r", msg->name, msg->a, msg->b);
+		break;
+	case MSG_THROTTLED:
+		printf("Task %s throttled: %ld runtime overruns\n\r", msg->name, msg->a);
+		break;
+	}
+}
 
-	struct timespec tr;
+// Prints one line of statistics of a histogram
+static void Print_Hist(const char *metric, const struct histogram *h)
+{
+	printf("  %-10s %10lu %12ld %12ld %12ld %12ld %12ld %12ld\n\r", metric, h->count, h->min, Hist_Mean(h),
+		   Hist_Percentile(h, 50.0), Hist_Percentile(h, 99.0), Hist_Percentile(h, 99.9), h->max);
+}
+
+// Prints the statistics of all tasks (times in ns)
+void Print_Stats(void)
+{
+	int i, m;
 
-	// Add the two timespec variables
-	tr.tv_sec = ts1.tv_sec + ts2.tv_sec;
-	tr.tv_nsec = ts1.tv_nsec + ts2.tv_nsec;
-	// Check for nsec overflow
-	if (tr.tv_nsec >= NS_IN_SEC)
+	for (i = 0; i < ntasks; i++)
 	{
-		tr.tv_sec++;
-		tr.tv_nsec = tr.tv_nsec - NS_IN_SEC;
+		printf("Task %s: %d jobs, %d deadline misses, %d throttled, %lu skipped releases (%s)\n\r", tasks[i].attr.name,
+			   tasks[i].activations, tasks[i].deadlineMissed, tasks[i].throttled, tasks[i].release.skipped,
+			   Release_Name(tasks[i].attr.release));
+		printf("  %-10s %10s %12s %12s %12s %12s %12s %12s\n\r", "(ns)", "samples", "min", "mean", "p50", "p99", "p99.9", "max");
+		for (m = 0; m < METRICS; m++)
+			if (tasks[i].hist[m].count > 0 || m != M_SPIN)
+				Print_Hist(metricNames[m], &tasks[i].hist[m]);
+		if (tasks[i].attr.release == REL_HYBRID)
+			printf("  hybrid release: guard %ld ns\n\r", tasks[i].release.guard_ns);
+		if (tasks[i].attr.poolBlocks > 0)
+			printf("  pool: %u blocks of %zu bytes, at most %u in use, %u failed allocations\n\r",
+				   tasks[i].pool.nblocks, tasks[i].pool.blockSize, tasks[i].pool.maxUsed, tasks[i].pool.failed);
+		printf("  page faults (minor/major): %ld/%ld at start-up, %ld/%ld in steady state\n\r",
+			   tasks[i].startFaults.minor, tasks[i].startFaults.major,
+			   tasks[i].steadyFaults.minor, tasks[i].steadyFaults.major);
 	}
-
-	return (tr);
 }
 
-// Subtracts two timespect variables
-struct timespec TsSub(struct timespec ts1, struct timespec ts2)
+// Prints the wake-up latency and execution time with antagonists relative to the baseline
+void Print_Inflation(void)
 {
-	struct timespec tr;
+	static const int shown[] = {M_WAKEUP, M_EXEC};
+	const struct histogram *b, *h;
+	int i, k;
 
-	// Subtract second arg from first one
-	if ((ts1.tv_sec < ts2.tv_sec) || ((ts1.tv_sec == ts2.tv_sec) && (ts1.tv_nsec <= ts2.tv_nsec)))
+	for (i = 0; i < ntasks; i++)
 	{
-		// Result would be negative. Return 0
-		tr.tv_sec = tr.tv_nsec = 0;
+		if (!tasks[i].hasBaseline)
+			continue;
+
+		printf("Task %s with antagonists vs baseline (ns):\n\r", tasks[i].attr.name);
+		for (k = 0; k < 2; k++)
+		{
+			b = &tasks[i].base[shown[k]];
+			h = &tasks[i].hist[shown[k]];
+			printf("  %-10s mean %10ld -> %10ld (x%.2f)  p99 %10ld -> %10ld (x%.2f)  max %10ld -> %10ld (x%.2f)\n\r",
+				   metricNames[shown[k]],
+				   Hist_Mean(b), Hist_Mean(h), Hist_Mean(b) > 0 ? (double)Hist_Mean(h) / Hist_Mean(b) : 0.0,
+				   Hist_Percentile(b, 99.0), Hist_Percentile(h, 99.0),
+				   Hist_Percentile(b, 99.0) > 0 ? (double)Hist_Percentile(h, 99.0) / Hist_Percentile(b, 99.0) : 0.0,
+				   b->max, h->max, b->max > 0 ? (double)h->max / b->max : 0.0);
+		}
 	}
-	else
+}
+
+// Writes PREFIX.csv, PREFIX_hist.csv and PREFIX.json. Returns 0 on success
+int Export_Stats(const char *prefix)
+{
+	char path[256], metric[32];
+	FILE *csv, *hist, *json;
+	int i, m;
+
+	snprintf(path, sizeof(path), "%s.csv", prefix);
+	csv = fopen(path, "w");
+	snprintf(path, sizeof(path), "%s_hist.csv", prefix);
+	hist = fopen(path, "w");
+	snprintf(path, sizeof(path), "%s.json", prefix);
+	json = fopen(path, "w");
+
+	if (csv == NULL || hist == NULL || json == NULL)
 	{
-		// If T1 > T2, proceed
-		tr.tv_sec = ts1.tv_sec - ts2.tv_sec;
-		if (ts1.tv_nsec < ts2.tv_nsec)
+		printf("Cannot write statistics files %s.* [%s]\n\r", prefix, strerror(errno));
+		if (csv)
+			fclose(csv);
+		if (hist)
+			fclose(hist);
+		if (json)
+			fclose(json);
+		return -1;
+	}
+
+	Hist_WriteCsvHeader(csv);
+	fprintf(hist, "task,metric,bucket_max_ns,count\n");
+	fprintf(json, "{\"tasks\": [\n");
+
+	for (i = 0; i < ntasks; i++)
+	{
+		fprintf(json, "  {\"name\": \"%s\", \"period_ns\": %ld, \"deadline_ns\": %ld, \"jobs\": %d, "
+					  "\"deadline_misses\": %d, \"throttled\": %d, \"release\": \"%s\", \"skipped\": %lu, "
+					  "\"faults\": {\"startup_minor\": %ld, \"startup_major\": %ld, \"steady_minor\": %ld, \"steady_major\": %ld}",
+				tasks[i].attr.name, tasks[i].attr.period_ns, tasks[i].attr.deadline_ns,
+				tasks[i].activations, tasks[i].deadlineMissed, tasks[i].throttled,
+				Release_Name(tasks[i].attr.release), tasks[i].release.skipped,
+				tasks[i].startFaults.minor, tasks[i].startFaults.major,
+				tasks[i].steadyFaults.minor, tasks[i].steadyFaults.major);
+
+		for (m = 0; m < METRICS; m++)
 		{
-			tr.tv_nsec = ts1.tv_nsec + NS_IN_SEC - ts2.tv_nsec;
-			tr.tv_sec--;
+			if (tasks[i].hist[m].count == 0 && m == M_SPIN)
+				continue;
+			Hist_WriteCsv(csv, tasks[i].attr.name, metricNames[m], &tasks[i].hist[m]);
+			Hist_WriteCsvBuckets(hist, tasks[i].attr.name, metricNames[m], &tasks[i].hist[m]);
+			fprintf(json, ",\n    \"%s\": ", metricNames[m]);
+			Hist_WriteJson(json, &tasks[i].hist[m]);
 		}
-		else
+		for (m = 0; m < METRICS && tasks[i].hasBaseline; m++)
 		{
-			tr.tv_nsec = ts1.tv_nsec - ts2.tv_nsec;
+			if (tasks[i].base[m].count == 0 && m == M_SPIN)
+				continue;
+			snprintf(metric, sizeof(metric), "baseline_%s", metricNames[m]);
+			Hist_WriteCsv(csv, tasks[i].attr.name, metric, &tasks[i].base[m]);
+			Hist_WriteCsvBuckets(hist, tasks[i].attr.name, metric, &tasks[i].base[m]);
+			fprintf(json, ",\n    \"%s\": ", metric);
+			Hist_WriteJson(json, &tasks[i].base[m]);
 		}
+		fprintf(json, "}%s\n", i < ntasks - 1 ? "," : "");
 	}
+	fprintf(json, "]}\n");
 
-	return (tr);
+	fclose(csv);
+	fclose(hist);
+	fclose(json);
+
+	return 0;
+}
+
+/* ***********************************************
+* Auxiliary functions 
+* ************************************************/
+
+// SIGXCPU handler: the kernel throttled the SCHED_DEADLINE task of this thread
+void Throttle_Handler(int sig)
+{
+	(void)sig;
+	if (self != NULL)
+		__atomic_add_fetch(&self->throttled, 1, __ATOMIC_RELAXED);
+}
+
+// SIG_WAKEUP handler: nothing to do, the signal just interrupts the sleep
+void Wakeup_Handler(int sig)
+{
+	(void)sig;
 }
@@ -0,0 +1,489 @@
+/******************************************************************
+ * DETI/UA/IT - Real-Time Operating Systems course
+ *
+ * Release offset (phase) optimizer
+ *
+ * Starting all the tasks of a set at the same instant makes their
+ * first jobs, and every job of the hyperperiod that coincides with
+ * them, contend for the CPU at once. Suitable release offsets spread
+ * the demand and can shorten the worst-case response times a lot.
+ *
+ * phaseOpt reads a task set (see taskset.h), simulates its fixed
+ * priority schedule (one CPU per "cpu" value, the workload duration
+ * of each task as its execution time) over [0, max phase + 2 * H[, H
+ * being the hyperperiod, and searches the phases of all tasks on a
+ * grid, with coordinate descent from the phases in the file, from all
+ * zeros and from random restarts. A phase assignment is ranked by, in
+ * this order:
+ *   - deadline misses plus precedence violations (-a TASK:AFTER: every
+ *     job of TASK starts after the job of AFTER with the same index;
+ *     both must have the same period)
+ *   - the largest response time to deadline ratio
+ *   - the sum of the response time to deadline ratios
+ *   - the peak workload released at one instant on a CPU
+ *
+ * The result is printed as task-set lines for pt and, with -t TICK,
+ * as TMan_TaskRegisterAttributes() calls in TMan ticks (the search
+ * grid is then the tick).
+ *
+ * SCHED_DEADLINE tasks are simulated above all fixed priorities.
+ *
+ * Usage: phaseOpt [-g GRAIN] [-t TICK] [-r RESTARTS] [-a TASK:AFTER]... TASKSET
+ *   GRAIN: phase resolution (default 1ms), TICK: TMan tick; neither
+ *   may exceed the shortest period
+ *   RESTARTS: random starting points (default 8)
+ *
+ *****************************************************************/
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <unistd.h>
+
+#include "taskset.h"
+#include "load.h"
+#include "release.h"
+#include "schedDeadline.h"
+
+#define MS_2_NS(ms) ((int64_t)(ms) * 1000 * 1000)
+
+#define MAX_PRECEDENCES 16
+#define MAX_PENDING 64			 // Pending jobs per task in the simulation (more are misses)
+#define MAX_CANDIDATES 256		 // Phases tried per task and pass (the grid is thinned beyond)
+#define MAX_PASSES 20			 // Coordinate descent passes per starting point
+#define MAX_SIM_NS MS_2_NS(600000) // Simulated time cap (10 min)
+#define DL_PRIO 100				 // Simulated priority of SCHED_DEADLINE tasks
+
+/* Ranking of a phase assignment (see above) */
+struct score
+{
+	int infeasible;						 // Deadline misses + precedence violations
+	int64_t maxNorm;					 // Largest response time / deadline (ppm)
+	int64_t sumNorm;					 // Sum of response time / deadline (ppm)
+	int64_t peak;						 // Largest workload released at one instant on a CPU
+	int64_t wcrt[TASKSET_MAX_TASKS];	 // Worst response time of each task
+};
+
+/* Simulation state of one task */
+struct simTask
+{
+	int64_t nextRelease;
+	int64_t queue[MAX_PENDING]; // Release times of the pending jobs
+	int head, pending;
+	int64_t remaining; // Of the oldest pending job
+	int started;	   // The oldest pending job got the CPU
+	int64_t done;	   // Completed jobs
+};
+
+static struct taskSet set;
+static int ntasks;
+static int prio[TASKSET_MAX_TASKS];
+static int64_t wcet[TASKSET_MAX_TASKS];
+static struct
+{
+	const char *taskName, *afterName; // -a TASK:AFTER
+	int task, after;
+} prec[MAX_PRECEDENCES];
+static int nprec;
+static int64_t hyper;
+
+// Index of the task called "name", -1 if none
+static int Task_Index(const char *name)
+{
+	int i;
+
+	for (i = 0; i < ntasks; i++)
+		if (strcmp(set.task[i].name, name) == 0)
+			return i;
+	return -1;
+}
+
+static int64_t Gcd(int64_t a, int64_t b)
+{
+	int64_t t;
+
+	while (b != 0)
+	{
+		t = a % b;
+		a = b;
+		b = t;
+	}
+	return a;
+}
+
+// Pending task of a CPU that gets it: highest priority, then oldest job. -1 if none
+static int Pick(const struct simTask *sim, int cpu)
+{
+	int i, best = -1;
+
+	for (i = 0; i < ntasks; i++)
+	{
+		if (set.task[i].cpu != cpu || sim[i].pending == 0)
+			continue;
+		if (best < 0 || prio[i] > prio[best] ||
+			(prio[i] == prio[best] && sim[i].queue[sim[i].head] < sim[best].queue[sim[best].head]))
+			best = i;
+	}
+	return best;
+}
+
+// Simulates the schedule with the given phases and ranks it
+static void Simulate(const int64_t *phase, struct score *s)
+{
+	struct simTask sim[TASKSET_MAX_TASKS];
+	int running[TASKSET_MAX_TASKS]; // Per task: the task runs on its CPU now
+	int64_t t = 0, next, end, maxPhase = 0, released, r, norm;
+	int i, k, j;
+
+	memset(s, 0, sizeof(*s));
+	memset(sim, 0, sizeof(sim));
+	for (i = 0; i < ntasks; i++)
+	{
+		sim[i].nextRelease = phase[i];
+		if (phase[i] > maxPhase)
+			maxPhase = phase[i];
+	}
+	end = maxPhase + 2 * (hyper < MAX_SIM_NS ? hyper : MAX_SIM_NS);
+
+	while (t < end)
+	{
+		/* Releases */
+		for (i = 0; i < ntasks; i++)
+		{
+			if (sim[i].nextRelease != t)
+				continue;
+			sim[i].nextRelease += set.task[i].period_ns;
+			if (sim[i].pending == MAX_PENDING)
+			{
+				s->infeasible++;
+				continue;
+			}
+			if (sim[i].pending == 0)
+			{
+				sim[i].remaining = wcet[i];
+				sim[i].started = 0;
+			}
+			sim[i].queue[(sim[i].head + sim[i].pending++) % MAX_PENDING] = t;
+		}
+		for (i = 0; i < ntasks; i++)
+		{
+			released = 0;
+			for (k = 0; k < ntasks; k++)
+				if (set.task[k].cpu == set.task[i].cpu && sim[k].nextRelease - set.task[k].period_ns == t)
+					released += wcet[k];
+			if (released > s->peak)
+				s->peak = released;
+		}
+
+		/* Dispatch, one task per CPU */
+		memset(running, 0, sizeof(running));
+		for (i = 0; i < ntasks; i++)
+		{
+			j = Pick(sim, set.task[i].cpu);
+			if (j < 0 || running[j])
+				continue;
+			running[j] = 1;
+			if (!sim[j].started)
+			{
+				sim[j].started = 1;
+				for (k = 0; k < nprec; k++)
+					if (prec[k].task == j && sim[prec[k].after].done <= sim[j].done)
+						s->infeasible++;
+			}
+		}
+
+		/* Next event: a release or a completion */
+		next = end;
+		for (i = 0; i < ntasks; i++)
+		{
+			if (sim[i].nextRelease < next)
+				next = sim[i].nextRelease;
+			if (running[i] && t + sim[i].remaining < next)
+				next = t + sim[i].remaining;
+		}
+
+		for (i = 0; i < ntasks; i++)
+		{
+			if (!running[i])
+				continue;
+			sim[i].remaining -= next - t;
+			if (sim[i].remaining > 0)
+				continue;
+			r = next - sim[i].queue[sim[i].head];
+			if (r > s->wcrt[i])
+				s->wcrt[i] = r;
+			if (r > set.task[i].deadline_ns)
+				s->infeasible++;
+			sim[i].head = (sim[i].head + 1) % MAX_PENDING;
+			sim[i].pending--;
+			sim[i].done++;
+			sim[i].remaining = wcet[i];
+			sim[i].started = 0;
+		}
+		t = next;
+	}
+
+	/* Jobs still pending at the end count with their age so far */
+	for (i = 0; i < ntasks; i++)
+	{
+		if (sim[i].pending > 0 && t - sim[i].queue[sim[i].head] > s->wcrt[i])
+			s->wcrt[i] = t - sim[i].queue[sim[i].head];
+		norm = s->wcrt[i] * 1000000 / set.task[i].deadline_ns;
+		s->sumNorm += norm;
+		if (norm > s->maxNorm)
+			s->maxNorm = norm;
+	}
+}
+
+// Returns 1 if a ranks before b
+static int Better(const struct score *a, const struct score *b)
+{
+	if (a->infeasible != b->infeasible)
+		return a->infeasible < b->infeasible;
+	if (a->maxNorm != b->maxNorm)
+		return a->maxNorm < b->maxNorm;
+	if (a->sumNorm != b->sumNorm)
+		return a->sumNorm < b->sumNorm;
+	return a->peak < b->peak;
+}
+
+// Coordinate descent from "phase" on the grid. Updates phase and s
+static void Descend(int64_t *phase, struct score *s, int64_t grain)
+{
+	struct score trial;
+	int64_t keep, step, c;
+	int i, pass, improved = 1;
+
+	Simulate(phase, s);
+	for (pass = 0; pass < MAX_PASSES && improved; pass++)
+	{
+		improved = 0;
+		for (i = 0; i < ntasks; i++)
+		{
+			keep = phase[i];
+			step = grain * ((set.task[i].period_ns / grain + MAX_CANDIDATES - 1) / MAX_CANDIDATES);
+			if (step < grain)
+				step = grain;
+			for (c = 0; c < set.task[i].period_ns; c += step)
+			{
+				if (c == keep)
+					continue;
+				phase[i] = c;
+				Simulate(phase, &trial);
+				if (Better(&trial, s))
+				{
+					*s = trial;
+					keep = c;
+					improved = 1;
+				}
+			}
+			phase[i] = keep;
+		}
+	}
+}
+
+// Prints a time with the largest exact unit
+static void Print_Time(FILE *fp, int64_t ns)
+{
+	if (ns != 0 && ns % MS_2_NS(1000) == 0)
+		fprintf(fp, "%lds", (long)(ns / MS_2_NS(1000)));
+	else if (ns != 0 && ns % MS_2_NS(1) == 0)
+		fprintf(fp, "%ldms", (long)(ns / MS_2_NS(1)));
+	else if (ns % 1000 == 0)
+		fprintf(fp, "%ldus", (long)(ns / 1000));
+	else
+		fprintf(fp, "%ldns", (long)ns);
+}
+
+// Prints the per-task results of a phase assignment
+static void Print_Score(const char *title, const int64_t *phase, const struct score *s)
+{
+	int i;
+
+	printf("%s: %d deadline misses/precedence violations, peak release %.3f ms\n", title, s->infeasible,
+		   s->peak / 1e6);
+	printf("  %-16s %12s %12s %12s %8s\n", "task", "phase_ms", "wcrt_ms", "deadline_ms", "R/D");
+	for (i = 0; i < ntasks; i++)
+		printf("  %-16s %12.3f %12.3f %12.3f %8.3f\n", set.task[i].name, phase[i] / 1e6, s->wcrt[i] / 1e6,
+			   set.task[i].deadline_ns / 1e6, (double)s->wcrt[i] / set.task[i].deadline_ns);
+}
+
+// Prints the task set with the new phases, in the task-set file syntax
+static void Print_TaskSet(const int64_t *phase)
+{
+	const struct taskAttr *t;
+	int i;
+
+	printf("\n# Task set with optimized phases (pt)\n");
+	for (i = 0; i < ntasks; i++)
+	{
+		t = &set.task[i];
+		printf("task %s period=", t->name);
+		Print_Time(stdout, t->period_ns);
+		printf(" phase=");
+		Print_Time(stdout, phase[i]);
+		printf(" deadline=");
+		Print_Time(stdout, t->deadline_ns);
+		if (t->policy == SCHED_DEADLINE)
+		{
+			printf(" runtime=");
+			Print_Time(stdout, t->runtime_ns);
+			printf(" policy=deadline");
+		}
+		else
+			printf(" prio=%d policy=%s", t->priority,
+				   t->policy == SCHED_FIFO ? "fifo" : t->policy == SCHED_RR ? "rr" : "other");
+		if (t->cpu >= 0)
+			printf(" cpu=%d", t->cpu);
+		if (t->loadKind == LOAD_NONE)
+			printf(" load=none");
+		else
+		{
+			printf(" load=%s:", Load_Name(t->loadKind));
+			Print_Time(stdout, t->load_ns);
+		}
+		if (t->release != REL_NANOSLEEP)
+			printf(" release=%s", Release_Name(t->release));
+		if (t->poolBlocks > 0)
+			printf(" pool=%d:%d", t->poolBlocks, t->poolBlockSize);
+		printf("\n");
+	}
+	for (i = 0; i < set.nantagonists; i++)
+	{
+		printf("antagonist %s", Antagonist_Name(set.antagonist[i].kind));
+		if (set.antagonist[i].cpu >= 0)
+			printf(" cpu=%d", set.antagonist[i].cpu);
+		if (set.antagonist[i].count != 1)
+			printf(" count=%d", set.antagonist[i].count);
+		printf("\n");
+	}
+}
+
+// Prints the phases as TMan registrations, in ticks of "tick" ns
+static void Print_TMan(const int64_t *phase, int64_t tick)
+{
+	int i;
+
+	printf("\n    // Optimized phases (TMan tick = ");
+	Print_Time(stdout, tick);
+	printf("): int index, int phase, int period, int deadline\n");
+	for (i = 0; i < ntasks; i++)
+	{
+		if (set.task[i].period_ns % tick != 0 || set.task[i].deadline_ns % tick != 0)
+			printf("    // %s: period/deadline rounded to ticks\n", set.task[i].name);
+		printf("    TMan_TaskRegisterAttributes(%d, %ld, %ld, %ld); // %s\n", i, (long)(phase[i] / tick),
+			   (long)(set.task[i].period_ns / tick), (long)(set.task[i].deadline_ns / tick), set.task[i].name);
+	}
+}
+
+int main(int argc, char *argv[])
+{
+	int64_t grain = MS_2_NS(1), tick = 0;
+	int64_t phase[TASKSET_MAX_TASKS], best[TASKSET_MAX_TASKS], start[TASKSET_MAX_TASKS];
+	struct score s, bestScore, initial;
+	int restarts = 8, opt, i, n;
+	unsigned int seed = 1;
+	char *sep;
+
+	while ((opt = getopt(argc, argv, "g:t:r:a:")) != -1)
+	{
+		switch (opt)
+		{
+		case 'g':
+			grain = TaskSet_ParseTime(optarg);
+			break;
+		case 't':
+			tick = TaskSet_ParseTime(optarg);
+			break;
+		case 'r':
+			restarts = atoi(optarg);
+			break;
+		case 'a':
+			if (nprec == MAX_PRECEDENCES || (sep = strchr(optarg, ':')) == NULL)
+				goto usage;
+			*sep = '\0';
+			prec[nprec].taskName = optarg;
+			prec[nprec++].afterName = sep + 1;
+			break;
+		default:
+			goto usage;
+		}
+	}
+	if (optind != argc - 1 || grain <= 0 || tick < 0)
+		goto usage;
+	if (tick > 0)
+		grain = tick;
+
+	if ((ntasks = TaskSet_Load(argv[optind], &set)) <= 0)
+		return -1;
+
+	/* The grid must have at least one point per period */
+	for (i = 0; i < ntasks; i++)
+		if (set.task[i].period_ns < grain)
+		{
+			printf("Task %s: period shorter than the %s\n", set.task[i].name, tick > 0 ? "tick" : "grain");
+			return -1;
+		}
+
+	/* Precedences, by name */
+	for (i = 0; i < nprec; i++)
+	{
+		prec[i].task = Task_Index(prec[i].taskName);
+		prec[i].after = Task_Index(prec[i].afterName);
+		if (prec[i].task < 0 || prec[i].after < 0)
+		{
+			printf("Unknown task in precedence %s:%s\n", prec[i].taskName, prec[i].afterName);
+			return -1;
+		}
+		if (set.task[prec[i].task].period_ns != set.task[prec[i].after].period_ns)
+		{
+			printf("Precedence %s:%s: the tasks must have the same period\n", prec[i].taskName, prec[i].afterName);
+			return -1;
+		}
+	}
+
+	/* Simulation parameters */
+	hyper = 1;
+	for (i = 0; i < ntasks; i++)
+	{
+		prio[i] = (set.task[i].policy == SCHED_DEADLINE ? DL_PRIO : set.task[i].priority);
+		wcet[i] = (set.task[i].loadKind == LOAD_NONE || set.task[i].load_ns <= 0 ? 1 : set.task[i].load_ns);
+		if (hyper <= MAX_SIM_NS)
+			hyper = hyper / Gcd(hyper, set.task[i].period_ns) * set.task[i].period_ns;
+		start[i] = set.task[i].phase_ns;
+	}
+	if (hyper > MAX_SIM_NS)
+		printf("Hyperperiod above %ld s: simulating %ld s only\n", (long)(MAX_SIM_NS / MS_2_NS(1000)),
+			   (long)(2 * MAX_SIM_NS / MS_2_NS(1000)));
+
+	/* Starting points: the file, all zeros, random */
+	Simulate(start, &initial);
+	Print_Score("Phases of the task set", start, &initial);
+
+	memcpy(best, start, sizeof(best));
+	Descend(best, &bestScore, grain);
+	for (n = 0; n <= restarts; n++)
+	{
+		for (i = 0; i < ntasks; i++)
+			phase[i] = (n == 0 ? 0 : (rand_r(&seed) % (set.task[i].period_ns / grain)) * grain);
+		Descend(phase, &s, grain);
+		if (Better(&s, &bestScore))
+		{
+			bestScore = s;
+			memcpy(best, phase, sizeof(best));
+		}
+	}
+	printf("\n");
+	Print_Score("Optimized phases", best, &bestScore);
+
+	Print_TaskSet(best);
+	if (tick > 0)
+		Print_TMan(best, tick);
+
+	return 0;
+
+usage:
+	printf("Usage: %s [-g GRAIN] [-t TICK] [-r RESTARTS] [-a TASK:AFTER]... TASKSET\n", argv[0]);
+	return -1;
+}
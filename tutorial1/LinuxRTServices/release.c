@@ -0,0 +1,405 @@
+/******************************************************************
+ * DETI/UA/IT - Real-Time Operating Systems course
+ *
+ * Release mechanisms for periodic threads.
+ * See release.h
+ *
+ *****************************************************************/
+#define _GNU_SOURCE
+#include <sched.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/timerfd.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/syscall.h>
+
+#include "release.h"
+
+#define DISPATCH_EVENTS 16 // Timer expirations handled per epoll_wait()
+
+static const char *relNames[REL_KINDS] = {"nanosleep", "timerfd", "epoll", "signal", "hybrid"};
+
+/* Spin-wait hint to the CPU */
+#if defined(__x86_64__) || defined(__i386__)
+#define CPU_RELAX() __builtin_ia32_pause()
+#else
+#define CPU_RELAX() __asm__ __volatile__("" ::: "memory")
+#endif
+
+/* Epoll dispatcher */
+static pthread_t dispatcher;
+static int epollFd = -1;
+static int stopFd = -1; // eventfd that terminates the dispatcher
+static int syncFd = -1; // eventfd of Dispatcher_Remove(), acknowledged on syncSem
+static sem_t syncSem;
+static pthread_mutex_t syncLock = PTHREAD_MUTEX_INITIALIZER; // One Dispatcher_Remove() at a time
+
+/* ***********************************************
+* Auxiliary functions
+* ***********************************************/
+
+// Timer specification of first + k * period
+static struct itimerspec Timer_Spec(int64_t first_ns, int64_t period_ns)
+{
+	struct itimerspec spec;
+
+	spec.it_value = Time_NsToTs(first_ns);
+	spec.it_interval = Time_NsToTs(period_ns);
+	return spec;
+}
+
+// Waits for the timerfd to expire, returns the number of expirations
+static int Timerfd_Read(int fd)
+{
+	uint64_t expirations;
+
+	if (read(fd, &expirations, sizeof(expirations)) != sizeof(expirations))
+		return -1;
+	return (int)expirations;
+}
+
+// Sleeps until the guard interval before the release, then spins until the release
+static int Hybrid_Wait(struct release *rel)
+{
+	int64_t release = rel->next;
+	int64_t wake = release - rel->guard_ns;
+	struct timespec tw = Time_NsToTs(wake);
+	int64_t now = Time_Now();
+	int err;
+
+	/* A late thread neither sleeps nor spins */
+	if (now < wake)
+	{
+		err = clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &tw, NULL);
+		if (err != 0)
+		{
+			errno = err;
+			return -1;
+		}
+		now = Time_Now();
+		Hist_Add(&rel->sleepLat, now - wake);
+	}
+
+	/* Spin time: from the end of the sleep to the release */
+	rel->spin_ns = 0;
+	if (now < release)
+	{
+		rel->spin_ns = -now;
+		while ((now = Time_Now()) < release)
+			CPU_RELAX();
+		rel->spin_ns += now;
+	}
+
+	/* New guard: the chosen percentile of the window, plus a margin */
+	if (rel->sleepLat.count >= RELEASE_GUARD_WINDOW)
+	{
+		rel->guard_ns = Hist_Percentile(&rel->sleepLat, RELEASE_GUARD_PERCENTILE) + RELEASE_GUARD_MARGIN_NS;
+		if (rel->guard_ns < RELEASE_GUARD_MIN_NS)
+			rel->guard_ns = RELEASE_GUARD_MIN_NS;
+		if (rel->guard_ns > rel->period_ns / 2)
+			rel->guard_ns = rel->period_ns / 2;
+		Hist_Init(&rel->sleepLat);
+	}
+
+	return 0;
+}
+
+// Forwards each timerfd expiration to the thread it belongs to
+static void *Dispatcher_code(void *arg)
+{
+	struct epoll_event events[DISPATCH_EVENTS];
+	struct release *rel;
+	uint64_t expirations, synced;
+	int n, i;
+
+	(void)arg;
+	while (1)
+	{
+		n = epoll_wait(epollFd, events, DISPATCH_EVENTS, -1);
+		if (n < 0 && errno == EINTR)
+			continue;
+		if (n < 0)
+			break;
+
+		synced = 0;
+		for (i = 0; i < n; i++)
+		{
+			rel = events[i].data.ptr;
+			if (rel == NULL)
+				return NULL; // Stop requested
+			if (events[i].data.ptr == &syncFd)
+			{
+				if (read(syncFd, &expirations, sizeof(expirations)) == sizeof(expirations))
+					synced += expirations;
+				continue;
+			}
+
+			if (read(rel->fd, &expirations, sizeof(expirations)) != sizeof(expirations))
+				continue;
+			__atomic_add_fetch(&rel->pending, expirations, __ATOMIC_RELEASE);
+			sem_post(&rel->sem);
+		}
+
+		/* The whole batch is handled: no event of a removed timerfd is left */
+		for (; synced > 0; synced--)
+			sem_post(&syncSem);
+	}
+
+	return NULL;
+}
+
+/*
+ * Removes the timerfd of "rel" from the dispatcher and waits until the
+ * dispatcher has finished the events it may have already taken for it
+ */
+static void Dispatcher_Remove(struct release *rel)
+{
+	uint64_t one = 1;
+
+	pthread_mutex_lock(&syncLock);
+	epoll_ctl(epollFd, EPOLL_CTL_DEL, rel->fd, NULL);
+	if (write(syncFd, &one, sizeof(one)) == sizeof(one))
+		while (sem_wait(&syncSem) != 0 && errno == EINTR)
+			;
+	pthread_mutex_unlock(&syncLock);
+}
+
+/* ***********************************************
+* Public functions
+* ***********************************************/
+
+int Release_Init(struct release *rel, int kind, int64_t first_ns, int64_t period_ns)
+{
+	struct itimerspec spec = Timer_Spec(first_ns, period_ns);
+	struct epoll_event ev;
+	struct sigevent sev;
+	sigset_t sigset;
+
+	memset(rel, 0, sizeof(*rel));
+	rel->kind = kind;
+	rel->next = first_ns;
+	rel->period_ns = period_ns;
+	rel->fd = -1;
+
+	switch (kind)
+	{
+	case REL_NANOSLEEP:
+		return 0;
+
+	case REL_HYBRID:
+		rel->guard_ns = (RELEASE_GUARD_INIT_NS < period_ns / 2 ? RELEASE_GUARD_INIT_NS : period_ns / 2);
+		Hist_Init(&rel->sleepLat);
+		return 0;
+
+	case REL_TIMERFD:
+	case REL_EPOLL:
+		if (kind == REL_EPOLL && epollFd < 0)
+		{
+			errno = ENOTCONN; // No dispatcher
+			return -1;
+		}
+		rel->fd = timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC);
+		if (rel->fd < 0)
+			return -1;
+		if (kind == REL_EPOLL)
+		{
+			sem_init(&rel->sem, 0, 0);
+			ev.events = EPOLLIN;
+			ev.data.ptr = rel;
+			if (epoll_ctl(epollFd, EPOLL_CTL_ADD, rel->fd, &ev) != 0)
+				goto error;
+		}
+		if (timerfd_settime(rel->fd, TFD_TIMER_ABSTIME, &spec, NULL) != 0)
+			goto error;
+		return 0;
+
+	case REL_SIGNAL:
+		/* The signal is only accepted synchronously, by sigwaitinfo() */
+		sigemptyset(&sigset);
+		sigaddset(&sigset, RELEASE_SIGNAL);
+		pthread_sigmask(SIG_BLOCK, &sigset, NULL);
+
+		memset(&sev, 0, sizeof(sev));
+		sev.sigev_notify = SIGEV_THREAD_ID;
+		sev.sigev_signo = RELEASE_SIGNAL;
+		sev._sigev_un._tid = syscall(SYS_gettid);
+		if (timer_create(CLOCK_MONOTONIC, &sev, &rel->timer) != 0)
+			return -1;
+		if (timer_settime(rel->timer, TIMER_ABSTIME, &spec, NULL) != 0)
+		{
+			timer_delete(rel->timer);
+			return -1;
+		}
+		return 0;
+	}
+
+	errno = EINVAL;
+	return -1;
+
+error:
+	Release_Free(rel);
+	return -1;
+}
+
+int Release_Wait(struct release *rel)
+{
+	struct timespec next;
+	sigset_t sigset;
+	int n, err;
+
+	switch (rel->kind)
+	{
+	case REL_NANOSLEEP:
+	case REL_HYBRID:
+		/* A late thread is released at once, the missed releases are not skipped */
+		next = Time_NsToTs(rel->next);
+		err = (rel->kind == REL_HYBRID ? Hybrid_Wait(rel) : clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &next, NULL));
+		if (err < 0)
+			return -1;
+		if (err > 0)
+		{
+			errno = err;
+			return -1;
+		}
+		rel->next += rel->period_ns;
+		n = 1;
+		break;
+
+	case REL_TIMERFD:
+		n = Timerfd_Read(rel->fd);
+		break;
+
+	case REL_EPOLL:
+		/* Several posts may be consumed at once, wait until something is pending */
+		do
+		{
+			if (sem_wait(&rel->sem) != 0)
+				return -1;
+			n = (int)__atomic_exchange_n(&rel->pending, 0, __ATOMIC_ACQUIRE);
+		} while (n == 0);
+		break;
+
+	case REL_SIGNAL:
+		sigemptyset(&sigset);
+		sigaddset(&sigset, RELEASE_SIGNAL);
+		if (sigwaitinfo(&sigset, NULL) < 0)
+			return -1;
+		n = 1 + timer_getoverrun(rel->timer);
+		break;
+
+	default:
+		errno = EINVAL;
+		return -1;
+	}
+
+	if (n > 1)
+		rel->skipped += n - 1;
+	return n;
+}
+
+void Release_Free(struct release *rel)
+{
+	switch (rel->kind)
+	{
+	case REL_EPOLL:
+		if (epollFd >= 0 && rel->fd >= 0)
+			Dispatcher_Remove(rel); // Before the semaphore goes away
+		sem_destroy(&rel->sem);
+		/* fall through */
+	case REL_TIMERFD:
+		if (rel->fd >= 0)
+			close(rel->fd);
+		break;
+	case REL_SIGNAL:
+		timer_delete(rel->timer);
+		break;
+	}
+	rel->kind = REL_NONE;
+	rel->fd = -1;
+}
+
+int Release_StartDispatcher(int priority, int cpu)
+{
+	struct epoll_event ev;
+	struct sched_param parm;
+	pthread_attr_t attr;
+	cpu_set_t cpuset;
+	int err;
+
+	epollFd = epoll_create1(EPOLL_CLOEXEC);
+	stopFd = eventfd(0, EFD_CLOEXEC);
+	syncFd = eventfd(0, EFD_CLOEXEC);
+	if (epollFd < 0 || stopFd < 0 || syncFd < 0)
+	{
+		err = errno;
+		goto error;
+	}
+	ev.events = EPOLLIN;
+	ev.data.ptr = NULL;
+	epoll_ctl(epollFd, EPOLL_CTL_ADD, stopFd, &ev);
+	ev.data.ptr = &syncFd;
+	epoll_ctl(epollFd, EPOLL_CTL_ADD, syncFd, &ev);
+	sem_init(&syncSem, 0, 0);
+
+	pthread_attr_init(&attr);
+	pthread_attr_setinheritsched(&attr, PTHREAD_EXPLICIT_SCHED);
+	pthread_attr_setschedpolicy(&attr, SCHED_FIFO);
+	parm.sched_priority = priority;
+	pthread_attr_setschedparam(&attr, &parm);
+	if (cpu >= 0)
+	{
+		CPU_ZERO(&cpuset);
+		CPU_SET(cpu, &cpuset);
+		pthread_attr_setaffinity_np(&attr, sizeof(cpuset), &cpuset);
+	}
+	err = pthread_create(&dispatcher, &attr, Dispatcher_code, NULL);
+	pthread_attr_destroy(&attr);
+	if (err == 0)
+		return 0;
+	sem_destroy(&syncSem);
+
+error:
+	if (epollFd >= 0)
+		close(epollFd);
+	if (stopFd >= 0)
+		close(stopFd);
+	if (syncFd >= 0)
+		close(syncFd);
+	epollFd = stopFd = syncFd = -1;
+	return err;
+}
+
+void Release_StopDispatcher(void)
+{
+	uint64_t one = 1;
+
+	if (epollFd < 0)
+		return;
+
+	if (write(stopFd, &one, sizeof(one)) == sizeof(one))
+		pthread_join(dispatcher, NULL);
+	close(epollFd);
+	close(stopFd);
+	close(syncFd);
+	sem_destroy(&syncSem);
+	epollFd = stopFd = syncFd = -1;
+}
+
+const char *Release_Name(int kind)
+{
+	return (kind >= 0 && kind < REL_KINDS) ? relNames[kind] : "none";
+}
+
+int Release_Kind(const char *name)
+{
+	int kind;
+
+	for (kind = 0; kind < REL_KINDS; kind++)
+		if (strcmp(name, relNames[kind]) == 0)
+			return kind;
+	return REL_NONE;
+}
@@ -0,0 +1,105 @@
+/******************************************************************
+ * DETI/UA/IT - Real-Time Operating Systems course
+ *
+ * Release mechanisms for periodic threads. All of them release
+ * the thread at first + k * period on CLOCK_MONOTONIC:
+ *
+ *   nanosleep - absolute clock_nanosleep() on the next release
+ *   timerfd   - periodic timerfd, the thread blocks in read()
+ *   epoll     - periodic timerfd of each thread multiplexed on a
+ *               single dispatcher thread (epoll), which wakes the
+ *               thread through a semaphore
+ *   signal    - POSIX timer (timer_create) delivering RELEASE_SIGNAL
+ *               to the thread itself (SIGEV_THREAD_ID), the thread
+ *               blocks in sigwaitinfo()
+ *   hybrid    - clock_nanosleep() until the release minus a guard
+ *               interval, then busy-waits until the release. The
+ *               guard is recalibrated from a high percentile of the
+ *               wake-up latency of the sleeps, so that the spin stays
+ *               short while the thread rarely wakes up late
+ *
+ * Release_Init() and Release_Wait() must be called by the periodic
+ * thread itself. A blocked Release_Wait() returns -1 (errno EINTR)
+ * when a signal with a handler installed without SA_RESTART is
+ * delivered to the thread, so the usual wake-up signal still stops
+ * the thread.
+ *
+ *****************************************************************/
+#ifndef RELEASE_H
+#define RELEASE_H
+
+#include <stdint.h>
+#include <signal.h>
+#include <semaphore.h>
+
+#include "histogram.h"
+#include "rttime.h"
+
+#define RELEASE_SIGNAL (SIGRTMIN) // Signal of the "signal" mechanism
+
+/* Guard interval of the "hybrid" mechanism */
+#define RELEASE_GUARD_INIT_NS (50 * 1000) // Before the first calibration
+#define RELEASE_GUARD_MIN_NS (2 * 1000)	  // Lower bound
+#define RELEASE_GUARD_MARGIN_NS 2000	  // Added to the latency percentile
+#define RELEASE_GUARD_PERCENTILE 99.9	  // Sleep wake-up latency percentile covered
+#define RELEASE_GUARD_WINDOW 256		  // Sleeps per calibration
+
+enum releaseKind
+{
+	REL_NONE = -1,
+	REL_NANOSLEEP,
+	REL_TIMERFD,
+	REL_EPOLL,
+	REL_SIGNAL,
+	REL_HYBRID,
+	REL_KINDS
+};
+
+/* Release state of one periodic thread */
+struct release
+{
+	int kind;			   // One of enum releaseKind
+	int64_t next;		   // Next release (nanosleep, hybrid)
+	int64_t period_ns;	   // Period
+	int fd;				   // timerfd (timerfd, epoll)
+	timer_t timer;		   // POSIX timer (signal)
+	sem_t sem;			   // Posted by the dispatcher (epoll)
+	uint64_t pending;	   // Expirations not yet consumed (epoll)
+	uint64_t skipped;	   // Releases lost because the thread was late
+	int64_t guard_ns;	   // Sleep ends this long before the release (hybrid)
+	int64_t spin_ns;	   // Busy-wait time of the last release (hybrid)
+	struct histogram sleepLat; // Wake-up latency of the sleeps in the current window (hybrid)
+};
+
+/*
+ * Arms the release mechanism "kind": the first release is at the
+ * absolute time first_ns (CLOCK_MONOTONIC), then one release every
+ * period_ns.
+ * REL_EPOLL requires a running dispatcher. Returns 0 on success,
+ * -1 on error (errno set).
+ */
+int Release_Init(struct release *rel, int kind, int64_t first_ns, int64_t period_ns);
+
+/*
+ * Blocks until the next release. Returns the number of releases
+ * since the previous call (more than 1 if the thread was late; the
+ * surplus is added to rel->skipped), -1 on error or interruption.
+ */
+int Release_Wait(struct release *rel);
+
+/* Disarms the mechanism and frees its resources */
+void Release_Free(struct release *rel);
+
+/*
+ * Starts/stops the epoll dispatcher thread, with SCHED_FIFO "priority"
+ * (it must exceed the one of the threads it releases) and pinned to
+ * "cpu" (-1: no affinity). Returns 0 or an error number.
+ */
+int Release_StartDispatcher(int priority, int cpu);
+void Release_StopDispatcher(void);
+
+/* Kind <-> name conversions. Release_Kind() returns REL_NONE if unknown */
+const char *Release_Name(int kind);
+int Release_Kind(const char *name);
+
+#endif
@@ -0,0 +1,313 @@
+/******************************************************************
+ * DETI/UA/IT - Real-Time Operating Systems course
+ *
+ * Release mechanism benchmark
+ *
+ * Runs, for each release mechanism of release.h in turn, a set of
+ * idle periodic SCHED_FIFO threads (no workload, so that only the
+ * release path is measured) and reports:
+ *   - the wake-up latency distribution (actual minus intended release)
+ *   - the mean busy-wait time per release (hybrid mechanism)
+ *   - the CPU time consumed per release (user + system time of the
+ *     whole process, dispatcher included, from getrusage()) and the
+ *     resulting CPU utilisation
+ *
+ * Usage: releaseBench [-n THREADS] [-p PERIOD_US] [-d SECONDS]
+ *                     [-P PRIORITY] [-c CPU] [-o PREFIX]
+ * With -o, the histograms are written to PREFIX.csv / PREFIX_hist.csv
+ * (one "task" per mechanism).
+ *
+ *****************************************************************/
+#define _GNU_SOURCE
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+#include <errno.h>
+#include <signal.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <sys/resource.h>
+
+#include "release.h"
+#include "histogram.h"
+#include "rttime.h"
+
+/* ***********************************************
+* App specific defines
+* ***********************************************/
+#define MAX_THREADS 64						// Maximum number of benchmark threads
+#define START_DELAY_NS (100 * 1000 * 1000) // Delay from thread creation to the first release
+#define WARMUP_RELEASES 10					// Releases discarded at the start of each run
+
+#define SIG_WAKEUP SIGUSR2 // Interrupts the waits of the threads at the end of a run
+
+/* ***********************************************
+* Benchmark thread
+* ***********************************************/
+struct benchThread
+{
+	pthread_t threadid;
+	int kind;				// Release mechanism
+	int64_t first;			// First release (absolute)
+	int64_t period_ns;
+	struct histogram wakeup; // Wake-up latency
+	struct histogram spin;	 // Busy-wait time (hybrid)
+	struct release release;
+	int error;				// errno of Release_Init() or Release_Wait(), 0 if ok
+};
+
+static struct benchThread threads[MAX_THREADS];
+static volatile sig_atomic_t stop;
+
+/* ***********************************************
+* Auxiliary functions
+* ***********************************************/
+
+// User + system CPU time of the process, in ns
+static int64_t Cpu_ns(void)
+{
+	struct rusage ru;
+
+	getrusage(RUSAGE_SELF, &ru);
+	return ((int64_t)ru.ru_utime.tv_sec + ru.ru_stime.tv_sec) * NS_PER_SEC +
+		   ((int64_t)ru.ru_utime.tv_usec + ru.ru_stime.tv_usec) * 1000;
+}
+
+static void Wakeup_Handler(int sig)
+{
+	(void)sig; // Only interrupts the wait
+}
+
+static void *Bench_code(void *arg)
+{
+	struct benchThread *t = arg;
+	int64_t taNs, tsNs = t->first;
+	int64_t n = 0;
+	int released;
+
+	if (Release_Init(&t->release, t->kind, t->first, t->period_ns) != 0)
+	{
+		t->error = errno;
+		return NULL;
+	}
+
+	while (1)
+	{
+		released = Release_Wait(&t->release);
+		taNs = Time_Now();
+		if (stop)
+			break;
+		if (released < 0)
+		{
+			if (errno == EINTR)
+				continue;
+			t->error = errno;
+			break;
+		}
+
+		tsNs += (released - 1) * t->period_ns;
+		if (++n > WARMUP_RELEASES)
+		{
+			Hist_Add(&t->wakeup, taNs - tsNs);
+			Hist_Add(&t->spin, t->release.spin_ns);
+		}
+		tsNs += t->period_ns;
+	}
+
+	Release_Free(&t->release);
+	return NULL;
+}
+
+/* ***********************************************
+* Benchmark of one mechanism
+* ***********************************************/
+
+// Runs nthreads threads released by "kind" for "duration" seconds.
+// Merges their wake-up latencies into "wakeup", returns the CPU time used or -1
+static int64_t Bench_Run(int kind, int nthreads, int64_t period_ns, int duration, int prio, int cpu,
+						 struct histogram *wakeup, struct histogram *spin, uint64_t *skipped)
+{
+	struct sched_param parm;
+	pthread_attr_t attr;
+	cpu_set_t cpuset;
+	int64_t first, cpu0;
+	int i, err = 0;
+
+	stop = 0;
+	Hist_Init(wakeup);
+	Hist_Init(spin);
+	*skipped = 0;
+
+	if (kind == REL_EPOLL)
+	{
+		err = Release_StartDispatcher(prio < sched_get_priority_max(SCHED_FIFO) ? prio + 1 : prio, cpu);
+		if (err != 0)
+		{
+			printf("Error creating the epoll dispatcher [%s]\n\r", strerror(err));
+			return -1;
+		}
+	}
+
+	first = Time_Now() + START_DELAY_NS;
+	cpu0 = Cpu_ns();
+
+	for (i = 0; i < nthreads && err == 0; i++)
+	{
+		memset(&threads[i], 0, sizeof(threads[i]));
+		threads[i].kind = kind;
+		threads[i].first = first;
+		threads[i].period_ns = period_ns;
+		Hist_Init(&threads[i].wakeup);
+		Hist_Init(&threads[i].spin);
+
+		pthread_attr_init(&attr);
+		pthread_attr_setinheritsched(&attr, PTHREAD_EXPLICIT_SCHED);
+		pthread_attr_setschedpolicy(&attr, SCHED_FIFO);
+		parm.sched_priority = prio;
+		pthread_attr_setschedparam(&attr, &parm);
+		if (cpu >= 0)
+		{
+			CPU_ZERO(&cpuset);
+			CPU_SET(cpu, &cpuset);
+			pthread_attr_setaffinity_np(&attr, sizeof(cpuset), &cpuset);
+		}
+		err = pthread_create(&threads[i].threadid, &attr, Bench_code, &threads[i]);
+		pthread_attr_destroy(&attr);
+	}
+	if (err != 0)
+	{
+		printf("Error creating benchmark thread [%s]\n\r", strerror(err));
+		nthreads = i - 1;
+	}
+
+	sleep(duration);
+
+	stop = 1;
+	for (i = 0; i < nthreads; i++)
+		pthread_kill(threads[i].threadid, SIG_WAKEUP);
+	for (i = 0; i < nthreads; i++)
+		pthread_join(threads[i].threadid, NULL);
+	Release_StopDispatcher();
+	cpu0 = Cpu_ns() - cpu0;
+
+	for (i = 0; i < nthreads; i++)
+	{
+		if (threads[i].error != 0)
+		{
+			printf("The %s release failed: %s\n\r", Release_Name(kind), strerror(threads[i].error));
+			err = -1;
+		}
+		Hist_Merge(wakeup, &threads[i].wakeup);
+		Hist_Merge(spin, &threads[i].spin);
+		*skipped += threads[i].release.skipped;
+	}
+
+	return err != 0 ? -1 : cpu0;
+}
+
+/* *************************
+* main()
+* **************************/
+
+int main(int argc, char *argv[])
+{
+	static struct histogram wakeup[REL_KINDS], spin;
+	int nthreads = 4, duration = 5, prio = 80, cpu = 0;
+	int64_t period_ns = 1000 * 1000;
+	int64_t cpuNs, releases;
+	uint64_t skipped;
+	const char *prefix = NULL;
+	struct sigaction sa;
+	char path[256];
+	FILE *csv, *hist;
+	int opt, kind;
+
+	/* Process input args */
+	while ((opt = getopt(argc, argv, "n:p:d:P:c:o:")) != -1)
+	{
+		switch (opt)
+		{
+		case 'n':
+			nthreads = atoi(optarg);
+			break;
+		case 'p':
+			period_ns = atoll(optarg) * 1000;
+			break;
+		case 'd':
+			duration = atoi(optarg);
+			break;
+		case 'P':
+			prio = atoi(optarg);
+			break;
+		case 'c':
+			cpu = atoi(optarg);
+			break;
+		case 'o':
+			prefix = optarg;
+			break;
+		default:
+			optind = argc + 1; // Print usage
+		}
+	}
+	if (optind != argc || nthreads < 1 || nthreads > MAX_THREADS || period_ns <= 0 || duration < 1)
+	{
+		printf("Usage: %s [-n THREADS] [-p PERIOD_US] [-d SECONDS] [-P PRIORITY] [-c CPU] [-o PREFIX]\n\r"
+			   "  THREADS periodic threads per mechanism (default 4, max %d), all with period PERIOD_US\n\r"
+			   "  (default 1000), SCHED_FIFO PRIORITY (default 80) and pinned to CPU (default 0, -1: none),\n\r"
+			   "  run for SECONDS (default 5) each. PREFIX names the CSV histogram files\n\r", argv[0], MAX_THREADS);
+		return -1;
+	}
+
+	/* SIG_WAKEUP only interrupts the waits, hence no SA_RESTART */
+	memset(&sa, 0, sizeof(sa));
+	sa.sa_handler = Wakeup_Handler;
+	sigemptyset(&sa.sa_mask);
+	sigaction(SIG_WAKEUP, &sa, NULL);
+
+	printf("%d threads, period %ld ns, priority %d, cpu %d, %d s per mechanism\n\r",
+		   nthreads, period_ns, prio, cpu, duration);
+	printf("%-10s %9s %8s %10s %10s %10s %10s %10s %10s %12s %8s\n\r", "mechanism", "releases", "skipped",
+		   "min", "p50", "p99", "p99.9", "max", "spin", "cpu/release", "cpu%");
+
+	for (kind = 0; kind < REL_KINDS; kind++)
+	{
+		cpuNs = Bench_Run(kind, nthreads, period_ns, duration, prio, cpu, &wakeup[kind], &spin, &skipped);
+		if (cpuNs < 0)
+			continue;
+
+		/* Releases during the run, warm-up included */
+		releases = (int64_t)nthreads * duration * NS_PER_SEC / period_ns;
+		printf("%-10s %9ld %8lu %10ld %10ld %10ld %10ld %10ld %10ld %12ld %7.2f%%\n\r", Release_Name(kind),
+			   wakeup[kind].count, skipped, wakeup[kind].min, Hist_Percentile(&wakeup[kind], 50.0),
+			   Hist_Percentile(&wakeup[kind], 99.0), Hist_Percentile(&wakeup[kind], 99.9), wakeup[kind].max,
+			   Hist_Mean(&spin),
+			   releases > 0 ? cpuNs / releases : 0, 100.0 * cpuNs / ((double)duration * NS_PER_SEC));
+	}
+
+	if (prefix == NULL)
+		return 0;
+
+	snprintf(path, sizeof(path), "%s.csv", prefix);
+	csv = fopen(path, "w");
+	snprintf(path, sizeof(path), "%s_hist.csv", prefix);
+	hist = fopen(path, "w");
+	if (csv == NULL || hist == NULL)
+	{
+		printf("Cannot write the statistics files %s*\n\r", prefix);
+		return -1;
+	}
+	Hist_WriteCsvHeader(csv);
+	fprintf(hist, "task,metric,bucket_max_ns,count\n");
+	for (kind = 0; kind < REL_KINDS; kind++)
+	{
+		Hist_WriteCsv(csv, Release_Name(kind), "wakeup", &wakeup[kind]);
+		Hist_WriteCsvBuckets(hist, Release_Name(kind), "wakeup", &wakeup[kind]);
+	}
+	fclose(csv);
+	fclose(hist);
+
+	return 0;
+}
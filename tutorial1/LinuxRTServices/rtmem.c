@@ -0,0 +1,99 @@
+/******************************************************************
+ * DETI/UA/IT - Real-Time Operating Systems course
+ *
+ * Memory set-up for real-time threads.
+ * See rtmem.h
+ *
+ *****************************************************************/
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+
+#include "rtmem.h"
+
+static char *arena;		  // Arena base (NULL if none)
+static size_t arenaSize;  // Arena size
+static size_t arenaUsed;  // Next free offset
+
+int RtMem_Lock(void)
+{
+	return mlockall(MCL_CURRENT | MCL_FUTURE) == 0 ? 0 : errno;
+}
+
+int RtMem_ArenaInit(size_t size)
+{
+	long page = sysconf(_SC_PAGESIZE);
+	size_t i;
+
+	size = (size + page - 1) & ~(size_t)(page - 1);
+	arena = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_POPULATE, -1, 0);
+	if (arena == MAP_FAILED)
+	{
+		arena = NULL;
+		return errno;
+	}
+
+	/* Already locked with MCL_FUTURE, but the arena must not depend on it.
+	 * Touching each page also breaks the copy-on-write of the zero page */
+	mlock(arena, size);
+	for (i = 0; i < size; i += page)
+		arena[i] = 0;
+
+	arenaSize = size;
+	arenaUsed = 0;
+	return 0;
+}
+
+void RtMem_ArenaFree(void)
+{
+	if (arena != NULL)
+		munmap(arena, arenaSize);
+	arena = NULL;
+	arenaSize = arenaUsed = 0;
+}
+
+void *RtMem_Alloc(size_t size)
+{
+	size_t offset;
+
+	if (arena == NULL)
+		return NULL;
+
+	size = (size + RTMEM_ALIGN - 1) & ~(size_t)(RTMEM_ALIGN - 1);
+	offset = __atomic_fetch_add(&arenaUsed, size, __ATOMIC_RELAXED);
+	if (offset + size > arenaSize)
+	{
+		__atomic_fetch_sub(&arenaUsed, size, __ATOMIC_RELAXED);
+		return NULL;
+	}
+	return arena + offset;
+}
+
+size_t RtMem_ArenaUsed(void)
+{
+	return __atomic_load_n(&arenaUsed, __ATOMIC_RELAXED);
+}
+
+__attribute__((noinline)) void RtMem_PrefaultStack(size_t size)
+{
+	char stack[size];
+	volatile char *touch = stack; // The writes must not be optimised away
+	long page = sysconf(_SC_PAGESIZE);
+	size_t i;
+
+	for (i = 0; i < size; i += page)
+		touch[i] = 0;
+}
+
+void RtMem_Faults(struct rtFaults *faults)
+{
+	struct rusage ru;
+
+	getrusage(RUSAGE_THREAD, &ru);
+	faults->minor = ru.ru_minflt;
+	faults->major = ru.ru_majflt;
+}
@@ -0,0 +1,55 @@
+/******************************************************************
+ * DETI/UA/IT - Real-Time Operating Systems course
+ *
+ * Memory set-up for real-time threads: memory locking, stack
+ * prefaulting, a preallocated (locked and prefaulted) arena from
+ * which pools and other RT data are carved at start-up, and
+ * per-thread page fault counters to check that the steady state of
+ * the tasks is fault-free.
+ *
+ *****************************************************************/
+#ifndef RTMEM_H
+#define RTMEM_H
+
+#include <stddef.h>
+
+#define RTMEM_ALIGN 64 // Alignment of the arena allocations
+
+/* Page faults of a thread */
+struct rtFaults
+{
+	long minor; // Served without I/O (e.g. first touch of a page)
+	long major; // Required I/O
+};
+
+/*
+ * Locks all current and future memory of the process (mlockall).
+ * Returns 0 or an errno value.
+ */
+int RtMem_Lock(void);
+
+/*
+ * Maps, locks and prefaults an arena of "size" bytes.
+ * Returns 0 or an errno value.
+ */
+int RtMem_ArenaInit(size_t size);
+
+/* Unmaps the arena (all its allocations become invalid) */
+void RtMem_ArenaFree(void);
+
+/*
+ * Allocates "size" bytes (RTMEM_ALIGN aligned) from the arena.
+ * Lock-free, no system call, never freed. Returns NULL when exhausted.
+ */
+void *RtMem_Alloc(size_t size);
+
+/* Bytes of the arena already allocated */
+size_t RtMem_ArenaUsed(void);
+
+/* Touches "size" bytes of the calling thread's stack below the current frame */
+void RtMem_PrefaultStack(size_t size);
+
+/* Page faults of the calling thread so far */
+void RtMem_Faults(struct rtFaults *faults);
+
+#endif
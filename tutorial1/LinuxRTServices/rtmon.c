@@ -0,0 +1,114 @@
+/******************************************************************
+ * DETI/UA/IT - Real-Time Operating Systems course
+ *
+ * Live monitor of a running task set
+ *
+ * A "top" for pt: maps the live statistics published by pt (see
+ * livestats.h) read-only and redraws, every INTERVAL, the counters
+ * and latency distributions of each task. It runs as an ordinary
+ * process and never synchronises with the RT tasks, so it can be
+ * started, stopped and run at any rate without disturbing them.
+ *
+ * Usage: rtmon [-n NAME] [-i INTERVAL_MS] [-c COUNT]
+ *   NAME: shared memory published by pt (default /rtstats, see pt -s)
+ *   COUNT: number of refreshes (default: until SIGINT), one refresh
+ *          is printed without clearing the screen
+ *
+ *****************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <errno.h>
+#include <signal.h>
+
+#include "livestats.h"
+
+#define LIVE_NAME "/rtstats" // Default shared memory (as in pt)
+
+// Prints a summary line of a histogram (us)
+static void Print_Us(const char *metric, const struct histogram *h)
+{
+	if (h->count == 0)
+	{
+		printf("    %-10s %10s\n", metric, "-");
+		return;
+	}
+	printf("    %-10s %10lu %9.1f %9.1f %9.1f %9.1f %9.1f\n", metric, (unsigned long)h->count, h->min / 1e3,
+		   Hist_Percentile(h, 50.0) / 1e3, Hist_Percentile(h, 99.0) / 1e3, Hist_Percentile(h, 99.9) / 1e3, h->max / 1e3);
+}
+
+int main(int argc, char *argv[])
+{
+	const char *name = LIVE_NAME;
+	const struct liveStats *live;
+	static struct liveTask copy;
+	static uint64_t lastJobs[LIVE_MAX_TASKS];
+	int interval = 1000, count = -1, opt, n;
+	uint32_t i, m;
+	struct timespec ts;
+
+	while ((opt = getopt(argc, argv, "n:i:c:")) != -1)
+	{
+		switch (opt)
+		{
+		case 'n':
+			name = optarg;
+			break;
+		case 'i':
+			interval = atoi(optarg);
+			break;
+		case 'c':
+			count = atoi(optarg);
+			break;
+		default:
+			printf("Usage: %s [-n NAME] [-i INTERVAL_MS] [-c COUNT]\n", argv[0]);
+			return -1;
+		}
+	}
+	if (interval <= 0)
+		interval = 1000;
+
+	live = Live_Open(name);
+	if (live == NULL)
+	{
+		printf("Cannot open the live statistics %s [%s]\n", name, strerror(errno));
+		return -1;
+	}
+
+	ts.tv_sec = interval / 1000;
+	ts.tv_nsec = (long)(interval % 1000) * 1000000;
+	for (n = 0; count < 0 || n < count; n++)
+	{
+		if (count != 1)
+			printf("\033[H\033[2J"); // Clear the screen
+		printf("%s: pid %d, %u tasks%s\n", name, (int)live->pid, live->ntasks,
+			   (kill(live->pid, 0) != 0 && errno == ESRCH) ? " (exited)" : "");
+
+		for (i = 0; i < live->ntasks; i++)
+		{
+			if (Live_Read(&live->task[i], &copy) != 0)
+			{
+				printf("%-16s busy\n", live->task[i].name);
+				continue;
+			}
+			printf("%-16s period %ld us, deadline %ld us: %lu jobs (%.1f/s), %lu deadline misses, %lu skipped\n",
+				   copy.name, (long)(copy.period_ns / 1000), (long)(copy.deadline_ns / 1000), (unsigned long)copy.jobs,
+				   n > 0 ? (copy.jobs - lastJobs[i]) * 1000.0 / interval : 0.0, (unsigned long)copy.deadlineMisses,
+				   (unsigned long)copy.skipped);
+			lastJobs[i] = copy.jobs;
+
+			printf("    %-10s %10s %9s %9s %9s %9s %9s\n", "(us)", "samples", "min", "p50", "p99", "p99.9", "max");
+			for (m = 0; m < live->nmetrics; m++)
+				Print_Us(live->metricNames[m], &copy.hist[m]);
+		}
+		fflush(stdout);
+
+		if (count < 0 || n + 1 < count)
+			nanosleep(&ts, NULL);
+	}
+
+	Live_Close(live);
+	return 0;
+}
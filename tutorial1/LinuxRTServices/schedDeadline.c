@@ -0,0 +1,47 @@
+/******************************************************************
+ * DETI/UA/IT - Real-Time Operating Systems course
+ *
+ * Minimal SCHED_DEADLINE support for the periodic task runner.
+ *
+ *****************************************************************/
+#define _GNU_SOURCE
+#include <sched.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+
+#include "schedDeadline.h"
+
+int SchedDl_SetSelf(uint64_t runtime_ns, uint64_t deadline_ns, uint64_t period_ns)
+{
+	struct schedDlAttr attr;
+
+	memset(&attr, 0, sizeof(attr));
+	attr.size = sizeof(attr);
+	attr.sched_policy = SCHED_DEADLINE;
+	attr.sched_flags = SCHED_FLAG_DL_OVERRUN;
+	attr.sched_runtime = runtime_ns;
+	attr.sched_deadline = deadline_ns;
+	attr.sched_period = period_ns;
+
+	if (syscall(SYS_sched_setattr, 0, &attr, 0) != 0)
+		return errno;
+
+	return 0;
+}
+
+const char *SchedDl_StrError(int err)
+{
+	switch (err)
+	{
+	case EBUSY:
+		return "admission control failed, not enough bandwidth left";
+	case EPERM:
+		return "not permitted (needs CAP_SYS_NICE and an affinity spanning the whole root domain)";
+	case EINVAL:
+		return "invalid parameters (runtime <= deadline <= period required)";
+	default:
+		return strerror(err);
+	}
+}
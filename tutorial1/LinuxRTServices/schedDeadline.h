@@ -0,0 +1,46 @@
+/******************************************************************
+ * DETI/UA/IT - Real-Time Operating Systems course
+ *
+ * Minimal SCHED_DEADLINE support for the periodic task runner.
+ * glibc has no wrapper for sched_setattr(), so the syscall is
+ * invoked directly with the kernel's struct sched_attr layout.
+ *
+ *****************************************************************/
+#ifndef SCHED_DEADLINE_H
+#define SCHED_DEADLINE_H
+
+#include <stdint.h>
+
+#ifndef SCHED_DEADLINE
+#define SCHED_DEADLINE 6
+#endif
+
+#define SCHED_FLAG_DL_OVERRUN 0x04 // Send SIGXCPU when the task is throttled
+
+#define SCHED_DL_MIN_RUNTIME_NS 1024 // Smallest runtime accepted by the kernel
+
+/* Same layout as the kernel's struct sched_attr (include/uapi/linux/sched/types.h) */
+struct schedDlAttr
+{
+	uint32_t size;
+	uint32_t sched_policy;
+	uint64_t sched_flags;
+	int32_t sched_nice;
+	uint32_t sched_priority;
+	uint64_t sched_runtime;
+	uint64_t sched_deadline;
+	uint64_t sched_period;
+};
+
+/*
+ * Moves the calling thread to SCHED_DEADLINE with the given CBS
+ * parameters, asking for SIGXCPU on every runtime overrun.
+ * Returns 0 on success or an errno value: EBUSY means that the
+ * kernel's admission control rejected the reservation.
+ */
+int SchedDl_SetSelf(uint64_t runtime_ns, uint64_t deadline_ns, uint64_t period_ns);
+
+/* Describes an error returned by SchedDl_SetSelf() */
+const char *SchedDl_StrError(int err);
+
+#endif
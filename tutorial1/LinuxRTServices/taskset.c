@@ -0,0 +1,307 @@
+/******************************************************************
+ * DETI/UA/IT - Real-Time Operating Systems course
+ *
+ * Task-set file parser for the periodic task runner.
+ * See taskset.h for the file format.
+ *
+ *****************************************************************/
+#define _GNU_SOURCE
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#include "taskset.h"
+#include "schedDeadline.h"
+#include "load.h"
+#include "release.h"
+
+#define LINE_LEN 256 // Maximum line length of the task-set file
+
+#define DEFAULT_PRIORITY 50 // RT priority used when "prio" is omitted
+#define DEFAULT_LOAD_NS (20 * 1000 * 1000) // Job workload when "load" is omitted
+
+/* ***********************************************
+* Auxiliary functions
+* ***********************************************/
+
+int64_t TaskSet_ParseTime(const char *str)
+{
+	char *end;
+	int64_t value;
+
+	value = strtoll(str, &end, 10);
+	if (end == str || value < 0)
+		return -1;
+
+	if (*end == '\0' || strcmp(end, "ns") == 0)
+		return value;
+	if (strcmp(end, "us") == 0)
+		return value * 1000;
+	if (strcmp(end, "ms") == 0)
+		return value * 1000 * 1000;
+	if (strcmp(end, "s") == 0)
+		return value * 1000 * 1000 * 1000;
+
+	return -1;
+}
+
+// Parses an integer, returns 0 on success
+static int ParseInt(const char *str, int *value)
+{
+	char *end;
+
+	*value = strtol(str, &end, 10);
+	return (end == str || *end != '\0');
+}
+
+// Maps a policy name to the corresponding SCHED_* constant. Returns -1 on error
+static int ParsePolicy(const char *str)
+{
+	if (strcmp(str, "fifo") == 0)
+		return SCHED_FIFO;
+	if (strcmp(str, "rr") == 0)
+		return SCHED_RR;
+	if (strcmp(str, "other") == 0)
+		return SCHED_OTHER;
+	if (strcmp(str, "deadline") == 0)
+		return SCHED_DEADLINE;
+
+	return -1;
+}
+
+// Parses a "KIND:TIME" workload or "none". Returns 0 on success
+static int ParseLoad(struct taskAttr *task, char *str)
+{
+	char *time = strchr(str, ':');
+
+	if (strcmp(str, "none") == 0)
+	{
+		task->loadKind = LOAD_NONE;
+		task->load_ns = 0;
+		return 0;
+	}
+
+	if (time == NULL)
+		return -1;
+	*time++ = '\0';
+
+	task->loadKind = Load_Kind(str);
+	task->load_ns = TaskSet_ParseTime(time);
+
+	return (task->loadKind == LOAD_NONE || task->load_ns <= 0);
+}
+
+// Parses a "N:SIZE" pool. Returns 0 on success
+static int ParsePool(struct taskAttr *task, char *str)
+{
+	char *size = strchr(str, ':');
+
+	if (size == NULL)
+		return -1;
+	*size++ = '\0';
+
+	return (ParseInt(str, &task->poolBlocks) || ParseInt(size, &task->poolBlockSize) ||
+			task->poolBlocks <= 0 || task->poolBlockSize <= 0);
+}
+
+// Applies one "key=value" token to a task. Returns 0 on success
+static int ParseAttr(struct taskAttr *task, char *token)
+{
+	char *value = strchr(token, '=');
+
+	if (value == NULL)
+		return -1;
+	*value++ = '\0';
+
+	if (strcmp(token, "period") == 0)
+		return (task->period_ns = TaskSet_ParseTime(value)) <= 0;
+	if (strcmp(token, "phase") == 0)
+		return (task->phase_ns = TaskSet_ParseTime(value)) < 0;
+	if (strcmp(token, "deadline") == 0)
+		return (task->deadline_ns = TaskSet_ParseTime(value)) <= 0;
+	if (strcmp(token, "runtime") == 0)
+		return (task->runtime_ns = TaskSet_ParseTime(value)) <= 0;
+	if (strcmp(token, "prio") == 0)
+		return ParseInt(value, &task->priority);
+	if (strcmp(token, "policy") == 0)
+		return (task->policy = ParsePolicy(value)) < 0;
+	if (strcmp(token, "cpu") == 0)
+		return ParseInt(value, &task->cpu);
+	if (strcmp(token, "load") == 0)
+		return ParseLoad(task, value);
+	if (strcmp(token, "release") == 0)
+		return (task->release = Release_Kind(value)) == REL_NONE;
+	if (strcmp(token, "pool") == 0)
+		return ParsePool(task, value);
+
+	return -1;
+}
+
+// Parses the rest of an "antagonist KIND [cpu=N] [count=N]" line. Returns 0 on success
+static int ParseAntagonist(struct antagonistAttr *ant, const char *path, int lineno)
+{
+	char *token, *value;
+
+	token = strtok(NULL, " \t\r\n");
+	if (token == NULL || (ant->kind = Antagonist_Kind(token)) == ANT_NONE)
+	{
+		printf("%s:%d: missing or unknown antagonist kind\n", path, lineno);
+		return -1;
+	}
+	ant->cpu = -1;
+	ant->count = 1;
+
+	while ((token = strtok(NULL, " \t\r\n")) != NULL)
+	{
+		value = strchr(token, '=');
+		if (value != NULL)
+			*value++ = '\0';
+
+		if (value != NULL && strcmp(token, "cpu") == 0 && ParseInt(value, &ant->cpu) == 0)
+			continue;
+		if (value != NULL && strcmp(token, "count") == 0 && ParseInt(value, &ant->count) == 0 && ant->count > 0)
+			continue;
+
+		printf("%s:%d: invalid antagonist attribute \"%s\"\n", path, lineno, token);
+		return -1;
+	}
+
+	return 0;
+}
+
+// Checks the attributes of a fully parsed task. Returns 0 if valid
+static int CheckTask(const struct taskAttr *task)
+{
+	int minPrio = sched_get_priority_min(task->policy);
+	int maxPrio = sched_get_priority_max(task->policy);
+
+	if (task->period_ns <= 0)
+		return printf("Task %s: missing period\n", task->name), -1;
+	if (task->deadline_ns > task->period_ns)
+		return printf("Task %s: deadline larger than period\n", task->name), -1;
+	if (task->load_ns >= task->period_ns)
+		return printf("Task %s: load must be shorter than the period\n", task->name), -1;
+
+	if (task->policy == SCHED_DEADLINE)
+	{
+		if (task->runtime_ns < SCHED_DL_MIN_RUNTIME_NS || task->runtime_ns > task->deadline_ns)
+			return printf("Task %s: runtime must be in [%d ns..deadline]\n", task->name, SCHED_DL_MIN_RUNTIME_NS), -1;
+		if (task->cpu >= 0)
+			return printf("Task %s: SCHED_DEADLINE tasks cannot be pinned to a CPU (use cpusets)\n", task->name), -1;
+		if (task->release != REL_NANOSLEEP)
+			return printf("Task %s: SCHED_DEADLINE tasks are released by the CBS (use release=nanosleep)\n", task->name), -1;
+		return 0;
+	}
+	if (task->runtime_ns != 0)
+		return printf("Task %s: runtime requires policy=deadline\n", task->name), -1;
+	if (task->priority < minPrio || task->priority > maxPrio)
+		return printf("Task %s: priority must be in [%d..%d]\n", task->name, minPrio, maxPrio), -1;
+
+	return 0;
+}
+
+/* ***********************************************
+* Public functions
+* ***********************************************/
+
+int TaskSet_Load(const char *path, struct taskSet *set)
+{
+	FILE *fp;
+	char line[LINE_LEN], *token, *comment;
+	int lineno = 0;
+	struct taskAttr *task;
+
+	set->ntasks = 0;
+	set->nantagonists = 0;
+
+	fp = fopen(path, "r");
+	if (fp == NULL)
+	{
+		printf("Cannot open task set %s\n", path);
+		return -1;
+	}
+
+	while (fgets(line, sizeof(line), fp) != NULL)
+	{
+		lineno++;
+
+		comment = strchr(line, '#');
+		if (comment != NULL)
+			*comment = '\0';
+
+		token = strtok(line, " \t\r\n");
+		if (token == NULL)
+			continue; // Empty line
+
+		if (strcmp(token, "antagonist") == 0)
+		{
+			if (set->nantagonists == TASKSET_MAX_ANTAGONISTS)
+			{
+				printf("%s:%d: too many antagonists (max %d)\n", path, lineno, TASKSET_MAX_ANTAGONISTS);
+				goto error;
+			}
+			if (ParseAntagonist(&set->antagonist[set->nantagonists], path, lineno))
+				goto error;
+			set->nantagonists++;
+			continue;
+		}
+
+		if (strcmp(token, "task") != 0)
+		{
+			printf("%s:%d: unknown entry \"%s\"\n", path, lineno, token);
+			goto error;
+		}
+
+		if (set->ntasks == TASKSET_MAX_TASKS)
+		{
+			printf("%s:%d: too many tasks (max %d)\n", path, lineno, TASKSET_MAX_TASKS);
+			goto error;
+		}
+
+		token = strtok(NULL, " \t\r\n");
+		if (token == NULL || strchr(token, '=') != NULL)
+		{
+			printf("%s:%d: missing task name\n", path, lineno);
+			goto error;
+		}
+
+		/* Defaults */
+		task = &set->task[set->ntasks];
+		memset(task, 0, sizeof(*task));
+		strncpy(task->name, token, TASK_NAME_LEN - 1);
+		task->priority = DEFAULT_PRIORITY;
+		task->policy = SCHED_FIFO;
+		task->cpu = -1;
+		task->loadKind = LOAD_FP;
+		task->load_ns = DEFAULT_LOAD_NS;
+		task->release = REL_NANOSLEEP;
+
+		while ((token = strtok(NULL, " \t\r\n")) != NULL)
+		{
+			if (ParseAttr(task, token))
+			{
+				printf("%s:%d: invalid attribute \"%s\"\n", path, lineno, token);
+				goto error;
+			}
+		}
+
+		if (task->policy == SCHED_OTHER || task->policy == SCHED_DEADLINE)
+			task->priority = 0;
+		if (task->deadline_ns == 0)
+			task->deadline_ns = task->period_ns;
+
+		if (CheckTask(task))
+			goto error;
+
+		set->ntasks++;
+	}
+
+	fclose(fp);
+	return set->ntasks;
+
+error:
+	fclose(fp);
+	return -1;
+}
@@ -0,0 +1,78 @@
+/******************************************************************
+ * DETI/UA/IT - Real-Time Operating Systems course
+ *
+ * Task-set description for the periodic task runner.
+ *
+ * A task-set file has one task or antagonist per line, "#" starts
+ * a comment:
+ *
+ *   task NAME period=T [phase=T] [deadline=T] [prio=N]
+ *        [policy=fifo|rr|other|deadline] [runtime=T] [cpu=N] [load=KIND:T|none]
+ *        [release=nanosleep|timerfd|epoll|signal|hybrid] [pool=N:SIZE]
+ *
+ * Times (T) accept the ns, us, ms and s suffixes (default is ns).
+ * "deadline" defaults to the period, "cpu" to no affinity and
+ * "load" gives the kernel and duration of each job's workload, e.g.
+ * load=fp:20ms (kernels are listed in load.h, default fp:20ms).
+ * "release" selects how the jobs are released (see release.h,
+ * default nanosleep). "pool" preallocates N blocks of SIZE bytes
+ * for the per-job allocations of the task (see pool.h).
+ *
+ * "runtime" is the SCHED_DEADLINE budget and is required (and only
+ * allowed) with policy=deadline; such tasks have no priority and
+ * are always released with nanosleep.
+ *
+ *   antagonist KIND [cpu=N] [count=N]
+ *
+ * starts "count" (default 1) non-RT co-runner threads of the given
+ * kind (see antagonist.h), optionally pinned to a CPU.
+ *
+ *****************************************************************/
+#ifndef TASKSET_H
+#define TASKSET_H
+
+#include <stdint.h>
+
+#include "antagonist.h"
+
+#define TASKSET_MAX_TASKS 16 // Maximum number of tasks in a task set
+#define TASKSET_MAX_ANTAGONISTS 8 // Maximum number of antagonist entries
+#define TASK_NAME_LEN 16	 // Maximum task name length (incl. '\0')
+
+/* Attributes of one periodic task, as read from the task-set file */
+struct taskAttr
+{
+	char name[TASK_NAME_LEN];
+	int64_t period_ns;	 // Task period
+	int64_t phase_ns;	 // Release offset relative to the common start time
+	int64_t deadline_ns; // Relative deadline
+	int priority;		 // RT priority [1..99] (0 for SCHED_OTHER)
+	int64_t runtime_ns;	 // SCHED_DEADLINE runtime (budget per period)
+	int policy;			 // SCHED_FIFO, SCHED_RR, SCHED_OTHER or SCHED_DEADLINE
+	int cpu;			 // CPU the task is pinned to (-1: no affinity)
+	int loadKind;		 // Job workload kernel (enum loadKind)
+	int64_t load_ns;	 // Job workload duration
+	int release;		 // Release mechanism (enum releaseKind)
+	int poolBlocks;		 // Blocks of the per-task pool (0: no pool)
+	int poolBlockSize;	 // Size of each pool block (bytes)
+};
+
+/* Contents of a task-set file */
+struct taskSet
+{
+	struct taskAttr task[TASKSET_MAX_TASKS];
+	int ntasks;
+	struct antagonistAttr antagonist[TASKSET_MAX_ANTAGONISTS];
+	int nantagonists;
+};
+
+/*
+ * Reads the task-set file in "path" into "set".
+ * Returns the number of tasks read or -1 on error (reported on stdout).
+ */
+int TaskSet_Load(const char *path, struct taskSet *set);
+
+/* Parses a time value with an optional ns/us/ms/s suffix. Returns -1 on error */
+int64_t TaskSet_ParseTime(const char *str);
+
+#endif
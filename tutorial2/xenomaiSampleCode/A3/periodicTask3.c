@@ -8,19 +8,32 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <unistd.h>
 #include <signal.h>
 #include <math.h>
-#include <sem.h>
+#include <errno.h>
 #include <sys/mman.h> // For mlockall
 
 // Xenomai API (former Native API)
 #include <alchemy/task.h>
 #include <alchemy/timer.h>
-#include <alchemy/sem.h>
+
+#include "reporter.h" // Console output is done by a non-RT thread
+#include "load.h"     // Task workloads
+#include "overrun.h"  // Overrun policies
+#include "pipeline.h" // Zero-copy hand-over of the data between the tasks
 
 #define MS_2_NS(ms) (ms * 1000 * 1000) /* Convert ms to ns */
 
+/* Messages posted by the RT tasks to the reporter thread */
+#define MSG_IAT 0     // Inter-arrival time update: a = min, b = max
+#define MSG_WORK 1    // First run of the load: a = duration, b = kind
+#define MSG_OVERRUN 2 // Period overrun: a = releases missed, b = jobs caught up
+#define MSG_NUMBER 3  // Number received: a = value, b = latency since a published it (ns)
+#define MSG_NOFRAME 4 // No free frame, the job is lost
+#define MSG_WAITERR 5 // rt_task_wait_period() failed: a = error code
+
 /* *****************************************************
  * Define task structure for setting input arguments
  * *****************************************************/
@@ -28,6 +41,17 @@ struct taskArgsStruct
 {
     RTIME taskPeriod_ns;
     int some_other_arg;
+    struct reportChannel *channel; // Channel to the reporter thread
+    struct overrun overrun;        // Overrun policy and statistics (periodic tasks)
+    struct load load;              // Workload run by Heavy_Work() (one per task)
+    struct pipeStage *input;       // Frames that release the task (NULL: periodic)
+    struct pipeline *output;       // Successors of the task (NULL: none)
+};
+
+/* Data handed from a job to its successors, in place */
+struct sample
+{
+    int number;
 };
 
 /* *******************
@@ -45,21 +69,33 @@ struct taskArgsStruct
 #define TASK_C_PRIO 10 // RT priority [0..99]
 #define TASK_C_PERIOD_NS MS_2_NS(1000)
 
+#define TASK_LOAD_KIND LOAD_FP   // Workload kernel of the tasks (see load.h)
+#define TASK_LOAD_NS MS_2_NS(20) // Workload duration per activation
+
 #define BOOT_ITER 10 // Number of activations for warm-up
 
+#define TASK_OVERRUN_POLICY OVR_SKIP // Default overrun policy (see overrun.h), or argv[1]
+
+#define NFRAMES 4                                 // Samples in flight along the a -> b -> c chain
+#define FRAMES_MEM (POOL_ALIGN * (1 + 2 * NFRAMES)) // At least Pipe_Size(sizeof(struct sample), NFRAMES)
+
 RT_TASK task_a_desc; // Task decriptor
 RT_TASK task_b_desc; // Task decriptor
 RT_TASK task_c_desc; // Task decriptor
 
-RT_SEM sem;
-int shared_number;
+/* Precedence chain a -> b -> c: a fills a sample, b updates it in place and passes it on to c */
+struct pipeline pipeAB, pipeBC;
+struct pipeStage stageB, stageC;
+static char frames[FRAMES_MEM] __attribute__((aligned(POOL_ALIGN)));
+
 /* *********************
 * Function prototypes
 * **********************/
 void catch_signal(int sig); /* Catches CTRL + C to allow a controlled termination of the application */
 void wait_for_ctrl_c(void);
-void Heavy_Work(void);      /* Load task */
+void Heavy_Work(struct reportChannel *channel, struct load *load); /* Load task */
 void task_code(void *args); /* Task body */
+void format_msg(const struct reportMsg *msg); /* Formats the messages of the RT tasks */
 void task_code2(void *args); /* sporadic */
 
 /* ******************
@@ -68,19 +104,52 @@ void task_code2(void *args); /* sporadic */
 int main(int argc, char *argv[])
 {
     int err;
+    int overrunPolicy;
     struct taskArgsStruct taskAArgs;
     struct taskArgsStruct taskBArgs;
     struct taskArgsStruct taskCArgs;
     cpu_set_t cpuset;
-    int err_sem = rt_sem_create(&sem, "semaphore", 0, S_FIFO);
-    //int err_sem = rt_sem_create(&sem, "semaphore", 0, S_PRIO);
-    if(err_sem){
-        printf("Error creating semaphore!");
+
+    /* The frames are preallocated, b and c are released by the frames they receive */
+    if (Pipe_Size(sizeof(struct sample), NFRAMES) > sizeof(frames) ||
+        Pipe_Init(&pipeAB, frames, sizeof(struct sample), NFRAMES) ||
+        Pipe_Init(&pipeBC, NULL, 0, 0) || // No frames of its own: b forwards those of a
+        Stage_Init(&stageB) || Stage_Init(&stageC))
+    {
+        printf("Error creating the pipeline!\n");
+        return -1;
+    }
+    Pipe_Connect(&pipeAB, &stageB);
+    Pipe_Connect(&pipeBC, &stageC);
+
+    /* Overrun policy of the periodic tasks: skip, catchup or rephase */
+    overrunPolicy = (argc > 1 ? Overrun_Policy(argv[1]) : TASK_OVERRUN_POLICY);
+    if (overrunPolicy < 0)
+    {
+        printf("Usage: %s [skip|catchup|rephase]\n", argv[0]);
+        return -1;
     }
 
     /* Lock memory to prevent paging */
     mlockall(MCL_CURRENT | MCL_FUTURE);
 
+    /* Calibrate the workload of each task (before the RT tasks start) */
+    if (Load_Init(&taskAArgs.load, TASK_LOAD_KIND, TASK_LOAD_NS) ||
+        Load_Init(&taskBArgs.load, TASK_LOAD_KIND, TASK_LOAD_NS) ||
+        Load_Init(&taskCArgs.load, TASK_LOAD_KIND, TASK_LOAD_NS))
+    {
+        printf("Error allocating the %s workload\n", Load_Name(TASK_LOAD_KIND));
+        return -1;
+    }
+
+    /* Start the (non-RT) reporter thread */
+    err = Reporter_Start(format_msg);
+    if (err)
+    {
+        printf("Error creating reporter thread (error code = %d)\n", err);
+        return err;
+    }
+
     CPU_ZERO(&cpuset);
     CPU_SET(0, &cpuset);
     if(sched_setaffinity(0, sizeof(cpuset), &cpuset)) {
@@ -153,6 +222,16 @@ int main(int argc, char *argv[])
     /* Start RT task */
     /* Args: task decriptor, address of function/implementation and argument*/
     taskAArgs.taskPeriod_ns = TASK_A_PERIOD_NS;
+    Overrun_Init(&taskAArgs.overrun, overrunPolicy);
+    taskAArgs.channel = Reporter_Channel();
+    taskAArgs.input = NULL;
+    taskAArgs.output = &pipeAB;
+    taskBArgs.channel = Reporter_Channel();
+    taskBArgs.input = &stageB;
+    taskBArgs.output = &pipeBC;
+    taskCArgs.channel = Reporter_Channel();
+    taskCArgs.input = &stageC;
+    taskCArgs.output = NULL;
     rt_task_start(&task_a_desc, &task_code, (void *)&taskAArgs);
     rt_task_start(&task_b_desc, &task_code2, (void *)&taskBArgs);
     rt_task_start(&task_c_desc, &task_code2, (void *)&taskCArgs);
@@ -160,6 +239,10 @@ int main(int argc, char *argv[])
     /* wait for termination signal */
     wait_for_ctrl_c();
 
+    /* Flush pending messages */
+    Reporter_Stop();
+    Overrun_Print("a", &taskAArgs.overrun);
+
     return 0;
 }
 
@@ -178,11 +261,16 @@ void task_code(void *args)
     int niter = 0;
     unsigned long overruns;
     int err;
+    int job, njobs;
+    struct reportMsg msg;
+    struct sample *sample;
 
     /* Get task information */
     curtask = rt_task_self();
     rt_task_inquire(curtask, &curtaskinfo);
     taskArgs = (struct taskArgsStruct *)args;
+    strncpy(msg.name, curtaskinfo.name, REPORT_NAME_LEN - 1);
+    msg.name[REPORT_NAME_LEN - 1] = '\0';
     printf("Task %s init, period:%llu\n", curtaskinfo.name, taskArgs->taskPeriod_ns);
 
     /* Set task as periodic */
@@ -194,16 +282,44 @@ void task_code(void *args)
         err = rt_task_wait_period(&overruns);
         ta = rt_timer_read();
 
-        if (err)
+        njobs = 1;
+        if (err == -ETIMEDOUT)
+        {
+            /* The previous job ran past "overruns" releases: recover as the policy says */
+            njobs = Overrun_Jobs(&taskArgs->overrun, overruns);
+            if (taskArgs->overrun.policy == OVR_REPHASE)
+                rt_task_set_periodic(NULL, ta + taskArgs->taskPeriod_ns, taskArgs->taskPeriod_ns);
+
+            msg.type = MSG_OVERRUN;
+            msg.a = overruns;
+            msg.b = njobs - 1;
+            Report_Post(taskArgs->channel, &msg);
+        }
+        else if (err)
         {
-            printf("task %s overrun!!!\n", curtaskinfo.name);
+            msg.type = MSG_WAITERR;
+            msg.a = err;
+            Report_Post(taskArgs->channel, &msg);
             break;
         }
 
         niter++; // Coount number of activations
-        shared_number = 1;
 
-        printf("Task %s number %d\n", curtaskinfo.name, shared_number);
+        /* The job writes its output directly into a preallocated frame */
+        sample = Pipe_Acquire(taskArgs->output);
+        if (sample == NULL)
+        {
+            msg.type = MSG_NOFRAME;
+            Report_Post(taskArgs->channel, &msg);
+        }
+        else
+        {
+            sample->number = 1;
+            msg.type = MSG_NUMBER;
+            msg.a = sample->number;
+            msg.b = 0;
+            Report_Post(taskArgs->channel, &msg);
+        }
 
         /* Compute latency and jitter */
         if (niter == 1)
@@ -234,14 +350,20 @@ void task_code(void *args)
 
         if (update)
         {
-            printf("Task %s inter-arrival time: min: %llu / max: %llu\n\r", curtaskinfo.name, minTime, maxTime);
+            msg.type = MSG_IAT;
+            msg.a = minTime;
+            msg.b = maxTime;
+            Report_Post(taskArgs->channel, &msg);
             update = 0;
         }
 
-        /* Task "load" */
-        Heavy_Work();
+        /* Task "load": one job per release, plus the catch-up jobs after an overrun */
+        for (job = 0; job < njobs; job++)
+            Heavy_Work(taskArgs->channel, &taskArgs->load);
 
-        rt_sem_v(&sem);
+        /* Hands the frame over to b and releases it */
+        if (sample != NULL)
+            Pipe_Publish(taskArgs->output, sample);
     }
     return;
 }
@@ -258,25 +380,35 @@ void task_code2(void *args)
     int niter = 0;
     unsigned long overruns;
     int err;
+    struct reportMsg msg;
+    struct sample *sample;
 
     /* Get task information */
     curtask = rt_task_self();
     rt_task_inquire(curtask, &curtaskinfo);
     taskArgs = (struct taskArgsStruct *)args;
+    strncpy(msg.name, curtaskinfo.name, REPORT_NAME_LEN - 1);
+    msg.name[REPORT_NAME_LEN - 1] = '\0';
     printf("Task %s init\n", curtaskinfo.name);
     
 
     for (;;)
     {
         
-        rt_sem_p(&sem, TM_INFINITE);
+        /* Released by the frame of its predecessor */
+        sample = Stage_Wait(taskArgs->input);
+        if (sample == NULL)
+            break;
 
         ta = rt_timer_read();
 
         niter++; // Coount number of activations
-        shared_number++;
+        sample->number++; // This task is the only holder of the frame: updates it in place
 
-        printf("Task %s number %d\n", curtaskinfo.name, shared_number);
+        msg.type = MSG_NUMBER;
+        msg.a = sample->number;
+        msg.b = ta - Pipe_FrameTime(sample);
+        Report_Post(taskArgs->channel, &msg);
 
         /* Compute latency and jitter */
         if (niter == 1)
@@ -312,15 +444,44 @@ void task_code2(void *args)
         }
 
         /* Task "load" */
-        Heavy_Work();
+        Heavy_Work(taskArgs->channel, &taskArgs->load);
 
-        if(strcmp(curtaskinfo.name, "Task c")){
-            rt_sem_v(&sem);
-        }
+        /* Passes the frame on to the successors (if any), without copying it */
+        if (taskArgs->output != NULL)
+            Pipe_Forward(taskArgs->output, sample);
+        Pipe_Release(sample);
     }
     return;
 }
 
+/* **************************************************************************
+ *  Formats the messages posted by the RT tasks (runs in the reporter thread)
+ * **************************************************************************/
+void format_msg(const struct reportMsg *msg)
+{
+    switch (msg->type)
+    {
+    case MSG_IAT:
+        printf("Task %s inter-arrival time: min: %lld / max: %lld\n\r", msg->name, (long long)msg->a, (long long)msg->b);
+        break;
+    case MSG_WORK:
+        printf("Load %s: first run took %9lld ns.\n", Load_Name(msg->b), (long long)msg->a);
+        break;
+    case MSG_OVERRUN:
+        printf("Task %s overrun: %lld releases missed, %lld jobs caught up\n", msg->name, (long long)msg->a, (long long)msg->b);
+        break;
+    case MSG_WAITERR:
+        printf("Task %s: rt_task_wait_period() failed (error code = %lld), task stopped\n", msg->name, (long long)msg->a);
+        break;
+    case MSG_NUMBER:
+        printf("Task %s number %lld (%lld ns after task a)\n", msg->name, (long long)msg->a, (long long)msg->b);
+        break;
+    case MSG_NOFRAME:
+        printf("Task %s: no free frame, job output lost\n", msg->name);
+        break;
+    }
+}
+
 /* **************************************************************************
  *  Catch control+c to allow a controlled termination
  * **************************************************************************/
@@ -342,40 +503,20 @@ void wait_for_ctrl_c(void)
 }
 
 /* **************************************************************************
- *  Task load implementation. In the case integrates numerically a function
+ *  Task load implementation. Runs the calibrated workload (see load.h)
  * **************************************************************************/
-#define f(x) 1 / (1 + pow(x, 2)) /* Define function to integrate*/
-void Heavy_Work(void)
+void Heavy_Work(struct reportChannel *channel, struct load *load)
 {
-    float lower, upper, integration = 0.0, stepSize, k;
-    int i, subInterval;
-
     RTIME ts, // Function start time
         tf;   // Function finish time
 
     static int first = 0; // Flag to signal first execution
+    struct reportMsg msg = {.type = MSG_WORK};
 
     /* Get start time */
     ts = rt_timer_read();
 
-    /* Integration parameters */
-    /*These values can be tunned to cause a desired load*/
-    lower = 0;
-    upper = 100;
-    subInterval = 1000000;
-
-    /* Calculation */
-    /* Finding step size */
-    stepSize = (upper - lower) / subInterval;
-
-    /* Finding Integration Value */
-    integration = f(lower) + f(upper);
-    for (i = 1; i <= subInterval - 1; i++)
-    {
-        k = lower + i * stepSize;
-        integration = integration + 2 * f(k);
-    }
-    integration = integration * stepSize / 2;
+    Load_Run(load);
 
     /* Get finish time and show results */
     if (!first)
@@ -383,7 +524,9 @@ void Heavy_Work(void)
         tf = rt_timer_read();
         tf -= ts; // Compute time difference form start to finish
 
-        printf("Integration value is: %.3f. It took %9llu ns to compute.\n", integration, tf);
+        msg.a = tf;
+        msg.b = load->kind;
+        Report_Post(channel, &msg);
 
         first = 1;
     }
@@ -8,9 +8,11 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <unistd.h>
 #include <signal.h>
 #include <math.h>
+#include <errno.h>
 
 #include <sys/mman.h> // For mlockall
 
@@ -18,8 +20,18 @@
 #include <alchemy/task.h>
 #include <alchemy/timer.h>
 
+#include "reporter.h" // Console output is done by a non-RT thread
+#include "load.h"	  // Task workloads
+#include "overrun.h"  // Overrun policies
+
 #define MS_2_NS(ms) (ms * 1000 * 1000) /* Convert ms to ns */
 
+/* Messages posted by the RT tasks to the reporter thread */
+#define MSG_IAT 0	  // Inter-arrival time update: a = min, b = max
+#define MSG_WORK 1	  // First run of the load: a = duration, b = kind
+#define MSG_OVERRUN 2 // Period overrun: a = releases missed, b = jobs caught up
+#define MSG_WAITERR 3 // rt_task_wait_period() failed: a = error code
+
 /* *****************************************************
  * Define task structure for setting input arguments
  * *****************************************************/
@@ -27,6 +39,9 @@ struct taskArgsStruct
 {
 	RTIME taskPeriod_ns;
 	int some_other_arg;
+	struct reportChannel *channel; // Channel to the reporter thread
+	struct overrun overrun;		   // Overrun policy and statistics (periodic tasks)
+	struct load load;		   // Workload run by Heavy_Work() (one per task)
 };
 
 /* *******************
@@ -37,8 +52,13 @@ struct taskArgsStruct
 
 #define TASK_A_PRIO 25 // RT priority [0..99]
 #define TASK_A_PERIOD_NS MS_2_NS(1000)
+#define TASK_LOAD_KIND LOAD_FP   // Workload kernel of the tasks (see load.h)
+#define TASK_LOAD_NS MS_2_NS(20) // Workload duration per activation
+
 #define BOOT_ITER 10				// Number of activations for warm-up
 
+#define TASK_OVERRUN_POLICY OVR_SKIP // Default overrun policy (see overrun.h), or argv[1]
+
 RT_TASK task_a_desc; // Task decriptor
 
 /* *********************
@@ -46,8 +66,9 @@ RT_TASK task_a_desc; // Task decriptor
 * **********************/
 void catch_signal(int sig); /* Catches CTRL + C to allow a controlled termination of the application */
 void wait_for_ctrl_c(void);
-void Heavy_Work(void);		/* Load task */
+void Heavy_Work(struct reportChannel *channel, struct load *load); /* Load task */
 void task_code(void *args); /* Task body */
+void format_msg(const struct reportMsg *msg); /* Formats the messages of the RT tasks */
 
 /* ******************
 * Main function
@@ -55,11 +76,35 @@ void task_code(void *args); /* Task body */
 int main(int argc, char *argv[])
 {
 	int err;
+	int overrunPolicy;
 	struct taskArgsStruct taskAArgs;
 
+	/* Overrun policy of the periodic tasks: skip, catchup or rephase */
+	overrunPolicy = (argc > 1 ? Overrun_Policy(argv[1]) : TASK_OVERRUN_POLICY);
+	if (overrunPolicy < 0)
+	{
+		printf("Usage: %s [skip|catchup|rephase]\n", argv[0]);
+		return -1;
+	}
+
 	/* Lock memory to prevent paging */
 	mlockall(MCL_CURRENT | MCL_FUTURE);
 
+	/* Calibrate the workload of each task (before the RT tasks start) */
+	if (Load_Init(&taskAArgs.load, TASK_LOAD_KIND, TASK_LOAD_NS))
+	{
+		printf("Error allocating the %s workload\n", Load_Name(TASK_LOAD_KIND));
+		return -1;
+	}
+
+	/* Start the (non-RT) reporter thread */
+	err = Reporter_Start(format_msg);
+	if (err)
+	{
+		printf("Error creating reporter thread (error code = %d)\n", err);
+		return err;
+	}
+
 	/* Create RT task */
 	/* Args: descriptor, name, stack size, priority [0..99] and mode (flags for CPU, FPU, joinable ...) */
 	err = rt_task_create(&task_a_desc, "Task a", TASK_STKSZ, TASK_A_PRIO, TASK_MODE);
@@ -75,11 +120,17 @@ int main(int argc, char *argv[])
 	/* Start RT task */
 	/* Args: task decriptor, address of function/implementation and argument*/
 	taskAArgs.taskPeriod_ns = TASK_A_PERIOD_NS;
+	Overrun_Init(&taskAArgs.overrun, overrunPolicy);
+	taskAArgs.channel = Reporter_Channel();
 	rt_task_start(&task_a_desc, &task_code, (void *)&taskAArgs);
 
 	/* wait for termination signal */
 	wait_for_ctrl_c();
 
+	/* Flush pending messages */
+	Reporter_Stop();
+	Overrun_Print("a", &taskAArgs.overrun);
+
 	return 0;
 }
 
@@ -98,11 +149,15 @@ void task_code(void *args)
 	int niter = 0;
 	unsigned long overruns;
 	int err;
+	int job, njobs;
+	struct reportMsg msg;
 
 	/* Get task information */
 	curtask = rt_task_self();
 	rt_task_inquire(curtask, &curtaskinfo);
 	taskArgs = (struct taskArgsStruct *)args;
+	strncpy(msg.name, curtaskinfo.name, REPORT_NAME_LEN - 1);
+	msg.name[REPORT_NAME_LEN - 1] = '\0';
 	printf("Task %s init, period:%llu\n", curtaskinfo.name, taskArgs->taskPeriod_ns);
 
 	/* Set task as periodic */
@@ -113,9 +168,24 @@ void task_code(void *args)
 		err = rt_task_wait_period(&overruns);
 		ta = rt_timer_read();
 
-		if (err)
+		njobs = 1;
+		if (err == -ETIMEDOUT)
 		{
-			printf("task %s overrun!!!\n", curtaskinfo.name);
+			/* The previous job ran past "overruns" releases: recover as the policy says */
+			njobs = Overrun_Jobs(&taskArgs->overrun, overruns);
+			if (taskArgs->overrun.policy == OVR_REPHASE)
+				rt_task_set_periodic(NULL, ta + taskArgs->taskPeriod_ns, taskArgs->taskPeriod_ns);
+
+			msg.type = MSG_OVERRUN;
+			msg.a = overruns;
+			msg.b = njobs - 1;
+			Report_Post(taskArgs->channel, &msg);
+		}
+		else if (err)
+		{
+			msg.type = MSG_WAITERR;
+			msg.a = err;
+			Report_Post(taskArgs->channel, &msg);
 			break;
 		}
 
@@ -148,17 +218,44 @@ void task_code(void *args)
 		}
 		previousTime = ta;
 
-		if(update){
-			printf("Task %s inter-arrival time: min: %llu / max: %llu\n\r",curtaskinfo.name, minTime, maxTime);
-		  	update = 0;
+		if (update)
+		{
+			msg.type = MSG_IAT;
+			msg.a = minTime;
+			msg.b = maxTime;
+			Report_Post(taskArgs->channel, &msg);
+			update = 0;
 		}
 
-		/* Task "load" */
-		Heavy_Work();
+		/* Task "load": one job per release, plus the catch-up jobs after an overrun */
+		for (job = 0; job < njobs; job++)
+			Heavy_Work(taskArgs->channel, &taskArgs->load);
 	}
 	return;
 }
 
+/* **************************************************************************
+ *  Formats the messages posted by the RT tasks (runs in the reporter thread)
+ * **************************************************************************/
+void format_msg(const struct reportMsg *msg)
+{
+	switch (msg->type)
+	{
+	case MSG_IAT:
+		printf("Task %s inter-arrival time: min: %lld / max: %lld\n\r", msg->name, (long long)msg->a, (long long)msg->b);
+		break;
+	case MSG_WORK:
+		printf("Load %s: first run took %9lld ns.\n", Load_Name(msg->b), (long long)msg->a);
+		break;
+	case MSG_OVERRUN:
+		printf("Task %s overrun: %lld releases missed, %lld jobs caught up\n", msg->name, (long long)msg->a, (long long)msg->b);
+		break;
+	case MSG_WAITERR:
+		printf("Task %s: rt_task_wait_period() failed (error code = %lld), task stopped\n", msg->name, (long long)msg->a);
+		break;
+	}
+}
+
 /* **************************************************************************
  *  Catch control+c to allow a controlled termination
  * **************************************************************************/
@@ -180,40 +277,20 @@ void wait_for_ctrl_c(void)
 }
 
 /* **************************************************************************
- *  Task load implementation. In the case integrates numerically a function
+ *  Task load implementation. Runs the calibrated workload (see load.h)
  * **************************************************************************/
-#define f(x) 1 / (1 + pow(x, 2)) /* Define function to integrate*/
-void Heavy_Work(void)
+void Heavy_Work(struct reportChannel *channel, struct load *load)
 {
-	float lower, upper, integration = 0.0, stepSize, k;
-	int i, subInterval;
-
 	RTIME ts, // Function start time
 		tf;	  // Function finish time
 
 	static int first = 0; // Flag to signal first execution
+	struct reportMsg msg = {.type = MSG_WORK};
 
 	/* Get start time */
 	ts = rt_timer_read();
 
-	/* Integration parameters */
-	/*These values can be tunned to cause a desired load*/
-	lower = 0;
-	upper = 100;
-	subInterval = 1000000;
-
-	/* Calculation */
-	/* Finding step size */
-	stepSize = (upper - lower) / subInterval;
-
-	/* Finding Integration Value */
-	integration = f(lower) + f(upper);
-	for (i = 1; i <= subInterval - 1; i++)
-	{
-		k = lower + i * stepSize;
-		integration = integration + 2 * f(k);
-	}
-	integration = integration * stepSize / 2;
+	Load_Run(load);
 
 	/* Get finish time and show results */
 	if (!first)
@@ -221,7 +298,9 @@ void Heavy_Work(void)
 		tf = rt_timer_read();
 		tf -= ts; // Compute time difference form start to finish
 
-		printf("Integration value is: %.3f. It took %9llu ns to compute.\n", integration, tf);
+		msg.a = tf;
+		msg.b = load->kind;
+		Report_Post(channel, &msg);
 
 		first = 1;
 	}